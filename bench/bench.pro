@@ -0,0 +1,22 @@
+#-------------------------------------------------
+#
+# Benchmarks for the parsing and conversion code on deterministic
+# generated inputs. Like the command line tool it only links against
+# qtcore.
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+TARGET = versatacts-bench
+CONFIG += console c++11
+CONFIG -= app_bundle
+TEMPLATE = app
+
+include(../versatacts-core.pri)
+
+SOURCES += main.cpp \
+           datagenerator.cpp
+
+HEADERS += datagenerator.h
@@ -0,0 +1,257 @@
+/********************************************************************
+
+Name: Versatacts
+Homepage: http://github.com/ae5chylu5/versatacts
+Author: ae5chylu5
+Description: A versatile gui application capable of extracting and
+             converting contacts to/from a variety of popular
+             mobile formats.
+
+Copyright (C) 2016 ae5chylu5
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+********************************************************************/
+
+#include "datagenerator.h"
+
+static const char *firstNames[] = {
+    "James", "Mary", "John", "Patricia", "Robert", "Jennifer", "Michael", "Linda",
+    "William", "Elizabeth", "David", "Barbara", "Richard", "Susan", "Joseph", "Jessica",
+    "Thomas", "Sarah", "Charles", "Karen", "Jose", "Nancy", "Daniel", "Lisa"
+};
+
+static const char *lastNames[] = {
+    "Smith", "Johnson", "Williams", "Brown", "Jones", "Garcia", "Miller", "Davis",
+    "Rodriguez", "Martinez", "Hernandez", "Lopez", "Gonzalez", "Wilson", "Anderson",
+    "Thomas", "Taylor", "Moore", "Jackson", "Martin", "Lee", "Perez", "Thompson", "White"
+};
+
+static const char *streets[] = {
+    "Main Street", "Oak Avenue", "Pine Road", "Maple Lane", "Cedar Court", "Elm Drive"
+};
+
+static const char *notes[] = {
+    "call after 5pm", "Work: front desk", "(old number)", "met at conference!",
+    "ask for ext. 42", "birthday 12/03"
+};
+
+static const char *domains[] = {
+    "example.com", "mail.example.org", "example.net"
+};
+
+template <typename T, size_t N> static int countOf(T (&)[N]) { return int(N); }
+
+DataGenerator::DataGenerator(quint32 seed)
+    : state(seed ? seed : 1)
+{
+
+}
+
+// xorshift32, small and identical on every platform
+quint32 DataGenerator::next()
+{
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+int DataGenerator::range(int count)
+{
+    return next() % count;
+}
+
+bool DataGenerator::chance(int percent)
+{
+    return range(100) < percent;
+}
+
+// values in a pbb are separated by runs of at least two 00 bytes
+void DataGenerator::appendPadding(QByteArray &data)
+{
+    data.append(QByteArray(2 + range(6), '\0'));
+}
+
+QByteArray DataGenerator::firstName()
+{
+    return firstNames[range(countOf(firstNames))];
+}
+
+QByteArray DataGenerator::lastName()
+{
+    return lastNames[range(countOf(lastNames))];
+}
+
+QByteArray DataGenerator::phone()
+{
+    QByteArray value = chance(50) ? "+1" : "";
+    for (int i=0; i<10; i++) value.append(char('0' + range(10)));
+    return value;
+}
+
+QByteArray DataGenerator::email(const QByteArray &first, const QByteArray &last)
+{
+    return first.toLower() + "." + last.toLower() + "@" + domains[range(countOf(domains))];
+}
+
+QByteArray DataGenerator::url(const QByteArray &last)
+{
+    return "http://www." + last.toLower() + ".example.com/";
+}
+
+QByteArray DataGenerator::address()
+{
+    return QByteArray::number(1 + range(9999)) + " " + streets[range(countOf(streets))];
+}
+
+QByteArray DataGenerator::note()
+{
+    return notes[range(countOf(notes))];
+}
+
+// builds a pbb dump. the first line ends with the number of records and
+// every record after the first is introduced by a separator line such
+// as 010102. the names of a record are stored in front of the separator
+// at the end of the previous record. the separators hold the record
+// index in a single byte so a dump has at most maxPbbRecords records.
+QByteArray DataGenerator::pbb(int records)
+{
+    QByteArray data;
+    QByteArray first,last;
+
+    records = qMin(records, int(maxPbbRecords));
+
+    data.append("\x56\x50\x42\x42");
+    data.append(char(records & 0xff));
+    appendPadding(data);
+
+    // there is no separator in front of the first record
+    first = firstName();
+    last = lastName();
+    data.append(first);
+    appendPadding(data);
+    data.append(last);
+    appendPadding(data);
+
+    for (int k=1; k<=records; k++) {
+        data.append(phone());
+        appendPadding(data);
+        if (chance(40)) {
+            data.append(phone());
+            appendPadding(data);
+        }
+        if (chance(35)) {
+            data.append(email(first, last));
+            appendPadding(data);
+        }
+        if (chance(10)) {
+            data.append(url(last));
+            appendPadding(data);
+        }
+        if (chance(15)) {
+            data.append(address());
+            appendPadding(data);
+        }
+        if (chance(15)) {
+            // invalid characters are stripped again by sanitizeRecords
+            data.append("\x01*");
+            data.append(note());
+            appendPadding(data);
+        }
+
+        if (k == records) break;
+
+        first = firstName();
+        last = lastName();
+        data.append(last);
+        appendPadding(data);
+        data.append(first);
+        appendPadding(data);
+
+        data.append(char(k));
+        data.append("\x01\x02");
+        appendPadding(data);
+    }
+
+    return data;
+}
+
+// a monosim export is a name line followed by a phone number line
+QByteArray DataGenerator::monosim(int records)
+{
+    QByteArray data;
+    for (int k=0; k<records; k++) {
+        data.append(firstName());
+        data.append(' ');
+        data.append(lastName());
+        data.append('\n');
+        data.append(phone());
+        data.append('\n');
+    }
+    return data;
+}
+
+QByteArray DataGenerator::vcard()
+{
+    QByteArray first = firstName();
+    QByteArray last = lastName();
+    QByteArray card;
+
+    card.append("BEGIN:VCARD\nVERSION:3.0\n");
+    card.append("N:" + last + ";" + first + ";;;\n");
+    card.append("FN:" + first + " " + last + "\n");
+    card.append("TEL;TYPE=CELL:" + phone() + "\n");
+    if (chance(40)) card.append("TEL;TYPE=HOME:" + phone() + "\n");
+    if (chance(50)) card.append("EMAIL;TYPE=HOME:" + email(first, last) + "\n");
+    if (chance(15)) card.append("ADR;TYPE=HOME:;;" + address() + ";;;;\n");
+    if (chance(15)) card.append("NOTE:" + note() + "\n");
+    card.append("END:VCARD\n");
+    return card;
+}
+
+// writes files numbered vcf files into path and returns the number of
+// bytes written
+qint64 DataGenerator::vcfFolder(const QString &path, int files, int cardsPerFile)
+{
+    QDir dir(path);
+    dir.mkpath(".");
+
+    qint64 total = 0;
+    for (int i=0; i<files; i++) {
+        QFile vcfFile(dir.filePath(QString("contact_%1.vcf").arg(i, 6, 10, QLatin1Char('0'))));
+        if (!vcfFile.open(QIODevice::WriteOnly)) return -1;
+        for (int j=0; j<cardsPerFile; j++) total += vcfFile.write(vcard());
+        vcfFile.close();
+    }
+    return total;
+}
+
+// writes as many pbb dumps as it takes to hold records. returns the
+// number of bytes written or -1 if a file can't be written.
+qint64 DataGenerator::pbbFolder(const QString &path, int records)
+{
+    QDir dir(path);
+    dir.mkpath(".");
+
+    qint64 total = 0;
+    for (int i=0; records > 0; i++) {
+        QFile pbbFile(dir.filePath(QString("dump_%1.pbb").arg(i, 4, 10, QLatin1Char('0'))));
+        if (!pbbFile.open(QIODevice::WriteOnly)) return -1;
+        total += pbbFile.write(pbb(records));
+        pbbFile.close();
+        records -= maxPbbRecords;
+    }
+    return total;
+}
@@ -0,0 +1,65 @@
+/********************************************************************
+
+Name: Versatacts
+Homepage: http://github.com/ae5chylu5/versatacts
+Author: ae5chylu5
+Description: A versatile gui application capable of extracting and
+             converting contacts to/from a variety of popular
+             mobile formats.
+
+Copyright (C) 2016 ae5chylu5
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+********************************************************************/
+
+#ifndef DATAGENERATOR_H
+#define DATAGENERATOR_H
+
+#include <QByteArray>
+#include <QDir>
+#include <QFile>
+#include <QString>
+
+// DataGenerator produces deterministic test inputs for the benchmarks.
+// the same seed always yields the same bytes so runs can be compared
+// across machines and revisions.
+class DataGenerator
+{
+public:
+    static const int maxPbbRecords = 255; // the record separators count in a single byte
+
+    DataGenerator(quint32 seed = 1);
+    QByteArray pbb(int records);
+    qint64 pbbFolder(const QString &path, int records);
+    QByteArray monosim(int records);
+    QByteArray vcard();
+    qint64 vcfFolder(const QString &path, int files, int cardsPerFile);
+
+private:
+    quint32 next();
+    int range(int count);
+    bool chance(int percent);
+    void appendPadding(QByteArray &data);
+    QByteArray firstName();
+    QByteArray lastName();
+    QByteArray phone();
+    QByteArray email(const QByteArray &first, const QByteArray &last);
+    QByteArray url(const QByteArray &last);
+    QByteArray address();
+    QByteArray note();
+    quint32 state;
+};
+
+#endif // DATAGENERATOR_H
@@ -0,0 +1,334 @@
+/********************************************************************
+
+Name: Versatacts
+Homepage: http://github.com/ae5chylu5/versatacts
+Author: ae5chylu5
+Description: A versatile gui application capable of extracting and
+             converting contacts to/from a variety of popular
+             mobile formats.
+
+Copyright (C) 2016 ae5chylu5
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+********************************************************************/
+
+#include "contactconverter.h"
+#include "datagenerator.h"
+
+#include <QCommandLineOption>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QRegExp>
+#include <QTemporaryDir>
+
+#ifdef Q_OS_UNIX
+#include <sys/resource.h>
+#endif
+
+// samples of what a pbb dump contains before it is sanitized
+static const char *sampleFields[] = {
+    "John", "Smith", "+15551234567", "john.smith@example.com", "http://example.com/~john",
+    "123 Main Street", "--Mary Ann--", "#31", "5550001", "Work: call after 5pm!",
+    "\x01\x02Bob", "O'Neil", "mary@mail.example.org.", "  42 Wallaby Way, Sydney  "
+};
+
+static QTextStream outStream(stdout);
+
+// discards everything written to it so generateVCF is timed without
+// the cost of the disk
+class NullDevice : public QIODevice
+{
+protected:
+    qint64 readData(char *data, qint64 maxSize)
+    {
+        Q_UNUSED(data);
+        Q_UNUSED(maxSize);
+        return -1;
+    }
+
+    qint64 writeData(const char *data, qint64 maxSize)
+    {
+        Q_UNUSED(data);
+        return maxSize;
+    }
+};
+
+// high water mark of the resident set size in megabytes. it never goes
+// down so later stages include the memory used by earlier ones.
+static double peakRss()
+{
+#ifdef Q_OS_UNIX
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef Q_OS_MAC
+    return usage.ru_maxrss / (1024.0 * 1024.0);
+#else
+    return usage.ru_maxrss / 1024.0;
+#endif
+#else
+    return 0;
+#endif
+}
+
+static void reportHeader()
+{
+    outStream << qSetFieldWidth(12) << left << "stage" << qSetFieldWidth(10) << right
+              << "MB" << "records" << "ms" << "MB/s" << qSetFieldWidth(12) << "records/s"
+              << qSetFieldWidth(14) << "peak RSS MB" << qSetFieldWidth(0) << endl;
+}
+
+static void report(const QString &stage, qint64 bytes, qint64 records, qint64 nsecs)
+{
+    double secs = qMax<qint64>(nsecs, 1) / 1e9;
+    double mb = bytes / (1024.0 * 1024.0);
+    outStream << qSetFieldWidth(12) << left << stage << qSetFieldWidth(10) << right
+              << QString::number(mb, 'f', 2) << records
+              << QString::number(secs * 1000, 'f', 1)
+              << QString::number(mb / secs, 'f', 1)
+              << qSetFieldWidth(12) << QString::number(records / secs, 'f', 0)
+              << qSetFieldWidth(14) << QString::number(peakRss(), 'f', 1)
+              << qSetFieldWidth(0) << endl;
+}
+
+// the sanitizing code as it used to be, compiling every pattern for
+// every field. kept as the baseline for the classifier.
+static int classifyRegExp(QStringList &values)
+{
+    int total = 0;
+    for (int i=0; i<values.count(); i++) {
+        QString &value = values[i];
+        value.remove(QRegExp("[^\\w\\.\\+ \\#\\@\\-\\,\\:\\/]"));
+        value.remove(QRegExp("^[^\\w\\+\\#]+|\\W+$"));
+        if (value.isEmpty()) continue;
+        if (value.contains(QRegExp("^[A-Za-z_\\- \\.]+$"))) total += 1;
+        else if (value.contains(QRegExp("^[\\#\\+]?\\d{2,11}$"))) total += 2;
+        else if (value.contains(QRegExp("@"))) total += 3;
+        else if (value.contains(QRegExp("://"))) total += 4;
+        else if (value.contains(QRegExp("^\\d+ \\w+"))) total += 5;
+        else total += 6;
+    }
+    return total;
+}
+
+static int classifyTable(QStringList &values)
+{
+    int total = 0;
+    int start,length;
+    for (int i=0; i<values.count(); i++) {
+        QString &value = values[i];
+        length = FieldClassifier::sanitize(value.data(), value.length(), &start);
+        if (length == 0) continue;
+        total += FieldClassifier::classify(value.constData() + start, length, true);
+    }
+    return total;
+}
+
+static void benchClassifier(int fieldCount, bool baseline)
+{
+    const int sampleCount = sizeof(sampleFields) / sizeof(sampleFields[0]);
+    qint64 bytes = 0;
+
+    QStringList values;
+    values.reserve(fieldCount);
+    for (int i=0; i<fieldCount; i++) {
+        values << QString::fromLatin1(sampleFields[i % sampleCount]);
+        bytes += values.last().length();
+    }
+
+    QElapsedTimer timer;
+    QStringList work = values;
+    timer.start();
+    classifyTable(work);
+    report("classify", bytes, fieldCount, timer.nsecsElapsed());
+
+    if (baseline) {
+        work = values;
+        timer.start();
+        classifyRegExp(work);
+        report("regexp", bytes, fieldCount, timer.nsecsElapsed());
+    }
+}
+
+static void benchGenerate(ContactConverter &converter)
+{
+    NullDevice device;
+    device.open(QIODevice::WriteOnly);
+
+    QElapsedTimer timer;
+    timer.start();
+    converter.generateVCF(&device);
+    qint64 nsecs = timer.nsecsElapsed();
+    report("generate", device.pos(), converter.records.count(), nsecs);
+}
+
+static bool writeFile(const QString &path, const QByteArray &data)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) return false;
+    bool ok = file.write(data) == data.size();
+    file.close();
+    return ok;
+}
+
+// a pbb dump holds at most 255 records so the records are spread over
+// several dumps. only the decoding of each dump is timed.
+static bool benchPBB(DataGenerator &generator, const QDir &dir, int records)
+{
+    QString path = dir.filePath("pbb");
+    qint64 bytes = generator.pbbFolder(path, records);
+    if (bytes < 0) {
+        QTextStream(stderr) << path << ": cannot be written." << endl;
+        return false;
+    }
+
+    ContactConverter converter;
+    ContactStore decoded;
+    const QStringList dumps = QDir(path).entryList(QStringList() << "*.pbb", QDir::Files);
+    QElapsedTimer timer;
+    qint64 nsecs = 0;
+    for (int i=0; i<dumps.count(); i++) {
+        QFile pbbFile(QDir(path).filePath(dumps.at(i)));
+        pbbFile.open(QIODevice::ReadOnly);
+        timer.start();
+        converter.importPBB(&pbbFile);
+        nsecs += timer.nsecsElapsed();
+        pbbFile.close();
+        decoded.append(converter.records);
+    }
+    converter.records = decoded;
+    report("pbb", bytes, converter.records.count(), nsecs);
+
+    // a separator the decoder doesn't recognize merges records, which
+    // would make every figure below meaningless
+    if (converter.records.count() != records) {
+        QTextStream(stderr) << "pbb: decoded " << converter.records.count() << " of " << records << " records." << endl;
+        return false;
+    }
+
+    timer.start();
+    converter.sanitizeRecords();
+    report("sanitize", 0, converter.records.count(), timer.nsecsElapsed());
+
+    benchGenerate(converter);
+    return true;
+}
+
+static void benchMonosim(DataGenerator &generator, const QDir &dir, int records)
+{
+    QString path = dir.filePath("bench.monosim");
+    if (!writeFile(path, generator.monosim(records))) return;
+
+    ContactConverter converter;
+    QFile monosimFile(path);
+    monosimFile.open(QIODevice::ReadOnly);
+
+    QElapsedTimer timer;
+    timer.start();
+    converter.importMonosim(&monosimFile);
+    report("monosim", monosimFile.size(), converter.records.count(), timer.nsecsElapsed());
+    monosimFile.close();
+
+    benchGenerate(converter);
+}
+
+static void benchMerge(DataGenerator &generator, const QDir &dir, int files, int cardsPerFile, int threads)
+{
+    QString path = dir.filePath("merge");
+    qint64 bytes = generator.vcfFolder(path, files, cardsPerFile);
+    if (bytes < 0) return;
+
+    ContactConverter converter;
+    converter.setMaxThreads(threads);
+
+    QElapsedTimer timer;
+    timer.start();
+    converter.mergeRecords(path);
+    report("merge", bytes, converter.records.count(), timer.nsecsElapsed());
+
+    benchGenerate(converter);
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QCoreApplication::setApplicationName("versatacts-bench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Measures the throughput of the conversion stages on generated data.");
+    parser.addHelpOption();
+
+    QCommandLineOption stagesOption(QStringList() << "s" << "stages",
+                                    "Comma separated list of benchmarks to run: classify, pbb, monosim, merge (default all).",
+                                    "list", "classify,pbb,monosim,merge");
+    QCommandLineOption fieldsOption(QStringList() << "f" << "fields",
+                                    "Number of fields to classify (default 1000000).",
+                                    "count", "1000000");
+    QCommandLineOption recordsOption(QStringList() << "r" << "records",
+                                     "Number of records in the generated pbb and monosim files (default 100000).",
+                                     "count", "100000");
+    QCommandLineOption filesOption(QStringList() << "n" << "files",
+                                   "Number of vcf files in the generated merge folder (default 5000).",
+                                   "count", "5000");
+    QCommandLineOption cardsOption(QStringList() << "c" << "cards-per-file",
+                                   "Number of cards in each generated vcf file (default 1).",
+                                   "count", "1");
+    QCommandLineOption jobsOption(QStringList() << "j" << "jobs",
+                                  "Merge with up to <count> threads. Defaults to one per core.",
+                                  "count", "0");
+    QCommandLineOption seedOption(QStringList() << "seed",
+                                  "Seed of the data generator (default 1).",
+                                  "seed", "1");
+    QCommandLineOption dataDirOption(QStringList() << "d" << "data-dir",
+                                     "Generate the inputs in <dir> and keep them. Defaults to a temporary folder.",
+                                     "dir");
+    QCommandLineOption baselineOption(QStringList() << "b" << "baseline",
+                                      "Also time the old regular expression classifier.");
+    parser.addOption(stagesOption);
+    parser.addOption(fieldsOption);
+    parser.addOption(recordsOption);
+    parser.addOption(filesOption);
+    parser.addOption(cardsOption);
+    parser.addOption(jobsOption);
+    parser.addOption(seedOption);
+    parser.addOption(dataDirOption);
+    parser.addOption(baselineOption);
+    parser.process(a);
+
+    QStringList stages = parser.value(stagesOption).split(",", QString::SkipEmptyParts);
+    int records = parser.value(recordsOption).toInt();
+
+    QTemporaryDir tempDir;
+    QDir dataDir(parser.isSet(dataDirOption) ? parser.value(dataDirOption) : tempDir.path());
+    if (!dataDir.mkpath(".")) {
+        QTextStream(stderr) << dataDir.path() << ": cannot be created." << endl;
+        return 1;
+    }
+
+    DataGenerator generator(parser.value(seedOption).toUInt());
+
+    reportHeader();
+    if (stages.contains("classify")) {
+        benchClassifier(parser.value(fieldsOption).toInt(), parser.isSet(baselineOption));
+    }
+    if (stages.contains("pbb") && !benchPBB(generator, dataDir, records)) return 1;
+    if (stages.contains("monosim")) benchMonosim(generator, dataDir, records);
+    if (stages.contains("merge")) {
+        benchMerge(generator, dataDir, parser.value(filesOption).toInt(),
+                   parser.value(cardsOption).toInt(), parser.value(jobsOption).toInt());
+    }
+
+    return 0;
+}
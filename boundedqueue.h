@@ -0,0 +1,118 @@
+/********************************************************************
+
+Name: Versatacts
+Homepage: http://github.com/ae5chylu5/versatacts
+Author: ae5chylu5
+Description: A versatile gui application capable of extracting and
+             converting contacts to/from a variety of popular
+             mobile formats.
+
+Copyright (C) 2016 ae5chylu5
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+********************************************************************/
+
+#ifndef BOUNDEDQUEUE_H
+#define BOUNDEDQUEUE_H
+
+#include <QAtomicInt>
+#include <QList>
+#include <QMutex>
+#include <QQueue>
+#include <QWaitCondition>
+
+// BoundedQueue hands items from one thread to another. push() blocks
+// while the queue is full and pop() while it is empty so a fast stage
+// can never run further ahead than capacity items. the waits wake up
+// regularly to check the cancel flag of the converter.
+template <typename T>
+class BoundedQueue
+{
+public:
+    BoundedQueue(int capacity, const QAtomicInt *canceled = 0)
+        : capacity(capacity), isClosed(false), isAborted(false), canceled(canceled)
+    {
+
+    }
+
+    // returns false if the queue was aborted
+    bool push(const T &item)
+    {
+        QMutexLocker locker(&mutex);
+        while (items.count() >= capacity && !isStopped()) notFull.wait(&mutex, waitInterval);
+        if (isStopped()) return false;
+
+        items.enqueue(item);
+        notEmpty.wakeOne();
+        return true;
+    }
+
+    // returns false once the queue is closed and empty or was aborted
+    bool pop(T &item)
+    {
+        QMutexLocker locker(&mutex);
+        while (items.isEmpty() && !isClosed && !isStopped()) notEmpty.wait(&mutex, waitInterval);
+        if (isStopped() || items.isEmpty()) return false;
+
+        item = items.dequeue();
+        notFull.wakeOne();
+        return true;
+    }
+
+    // no more items will be pushed
+    void close()
+    {
+        QMutexLocker locker(&mutex);
+        isClosed = true;
+        notEmpty.wakeAll();
+    }
+
+    // stops both sides, e.g. when the consumer fails
+    void abort()
+    {
+        QMutexLocker locker(&mutex);
+        isAborted = true;
+        notEmpty.wakeAll();
+        notFull.wakeAll();
+    }
+
+    // the items left behind by an aborted queue
+    QList<T> takeAll()
+    {
+        QMutexLocker locker(&mutex);
+        QList<T> left = items;
+        items.clear();
+        return left;
+    }
+
+private:
+    static const int waitInterval = 50; // milliseconds
+
+    bool isStopped() const
+    {
+        return isAborted || (canceled && canceled->load());
+    }
+
+    QMutex mutex;
+    QWaitCondition notFull;
+    QWaitCondition notEmpty;
+    QQueue<T> items;
+    int capacity;
+    bool isClosed;
+    bool isAborted;
+    const QAtomicInt *canceled;
+};
+
+#endif // BOUNDEDQUEUE_H
@@ -0,0 +1,386 @@
+/********************************************************************
+
+Name: Versatacts
+Homepage: http://github.com/ae5chylu5/versatacts
+Author: ae5chylu5
+Description: A versatile gui application capable of extracting and
+             converting contacts to/from a variety of popular
+             mobile formats.
+
+Copyright (C) 2016 ae5chylu5
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+********************************************************************/
+
+#include "contactconverter.h"
+#include "folderwatcher.h"
+
+#include <QCommandLineOption>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+
+// a path of "-" writes to stdout. compressed output goes through
+// deflater, which stays empty for plain vcf. returns the device to write
+// to or 0 if the output can't be opened.
+static QIODevice *openOutput(QFile &vcfFile, const QString &path, CompressedDevice::Format format,
+                             QScopedPointer<CompressedDevice> &deflater)
+{
+    QIODevice::OpenMode mode = QIODevice::WriteOnly;
+    if (format == CompressedDevice::Plain) mode |= QIODevice::Text;
+
+    if (path == "-") {
+        if (!vcfFile.open(stdout, mode)) return 0;
+    } else {
+        vcfFile.setFileName(path);
+        if (!vcfFile.open(mode)) return 0;
+    }
+    if (format == CompressedDevice::Plain) return &vcfFile;
+
+    deflater.reset(new CompressedDevice(&vcfFile, format));
+    if (!deflater->open(QIODevice::WriteOnly)) return 0;
+    return deflater.data();
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QCoreApplication::setApplicationName("versatacts-cli");
+    QCoreApplication::setApplicationVersion("0.2");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Converts pbb or monosim files and folders of vcf files to vcf.");
+    parser.addHelpOption();
+    parser.addVersionOption();
+
+    QCommandLineOption outputOption(QStringList() << "o" << "output",
+                                    "Write the contacts of every input into a single vcf <file>. Use - for stdout.",
+                                    "file");
+    QCommandLineOption outputDirOption(QStringList() << "d" << "output-dir",
+                                       "Write one vcf per input into <dir>. Defaults to the folder of each input.",
+                                       "dir");
+    QCommandLineOption reverseOption(QStringList() << "r" << "reverse",
+                                     "Reverse the order of names (first <-> last).");
+    QCommandLineOption dedupOption(QStringList() << "dedup",
+                                   "Merge contacts sharing a name and phone number or email address.");
+    QCommandLineOption dropBinaryOption(QStringList() << "drop-binary",
+                                        "Drop photos, logos, sounds and keys of merged vcf files.");
+    QCommandLineOption maxBinaryOption(QStringList() << "max-binary-size",
+                                       "Drop photos, logos, sounds and keys larger than <kb> kilobytes.",
+                                       "kb");
+    QCommandLineOption combineOption(QStringList() << "c" << "combine",
+                                     "Decode all inputs at once on parallel threads and write them to --output as one list.");
+    QCommandLineOption streamOption(QStringList() << "s" << "stream",
+                                    "Convert each input in batches without keeping all of its records in memory.");
+    QCommandLineOption jobsOption(QStringList() << "j" << "jobs",
+                                  "Parse folders with up to <count> threads. Defaults to one per core.",
+                                  "count", "0");
+    QCommandLineOption cacheOption(QStringList() << "cache",
+                                   "Cache the records of merged folders so a re-merge only parses new or changed files.");
+    QCommandLineOption verifyCacheOption(QStringList() << "verify-cache",
+                                         "Compare cached files by a hash of their contents as well. Implies --cache.");
+    QCommandLineOption cacheDirOption(QStringList() << "cache-dir",
+                                      "Keep the merge cache in <dir>.",
+                                      "dir");
+    QCommandLineOption shardCardsOption(QStringList() << "shard-cards",
+                                        "Split each vcf into numbered shards of at most <count> cards.",
+                                        "count", "0");
+    QCommandLineOption shardSizeOption(QStringList() << "shard-size",
+                                       "Split each vcf into numbered shards of at most <kb> kilobytes.",
+                                       "kb", "0");
+    QCommandLineOption manifestOption(QStringList() << "manifest",
+                                      "List the shards of each vcf in a json manifest next to them.");
+    QCommandLineOption snapshotOption(QStringList() << "snapshot",
+                                      "Write a .vcsnap snapshot per input instead of a vcf. Snapshots can be used as inputs.");
+    QCommandLineOption compressOption(QStringList() << "z" << "compress",
+                                      "Compress the vcf files written with <format>, gz or zst. --output is compressed when its name ends in .gz or .zst.",
+                                      "format");
+    QCommandLineOption watchOption(QStringList() << "w" << "watch",
+                                   "Keep watching the input folder and add the cards of new or changed files to --output.");
+    QCommandLineOption rotateOption(QStringList() << "rotate",
+                                    "With --watch, write every batch to the next numbered file instead of appending.");
+    QCommandLineOption debounceOption(QStringList() << "debounce",
+                                      "With --watch, wait until the folder was quiet for <ms> milliseconds.",
+                                      "ms", "2000");
+    QCommandLineOption reportOption(QStringList() << "report",
+                                    "Write the wall time and counters of every stage as json to <file>.",
+                                    "file");
+    QCommandLineOption quietOption(QStringList() << "q" << "quiet",
+                                   "Only report errors.");
+    parser.addOption(outputOption);
+    parser.addOption(outputDirOption);
+    parser.addOption(reverseOption);
+    parser.addOption(dedupOption);
+    parser.addOption(dropBinaryOption);
+    parser.addOption(maxBinaryOption);
+    parser.addOption(combineOption);
+    parser.addOption(streamOption);
+    parser.addOption(jobsOption);
+    parser.addOption(cacheOption);
+    parser.addOption(verifyCacheOption);
+    parser.addOption(cacheDirOption);
+    parser.addOption(shardCardsOption);
+    parser.addOption(shardSizeOption);
+    parser.addOption(manifestOption);
+    parser.addOption(snapshotOption);
+    parser.addOption(compressOption);
+    parser.addOption(watchOption);
+    parser.addOption(rotateOption);
+    parser.addOption(debounceOption);
+    parser.addOption(reportOption);
+    parser.addOption(quietOption);
+    parser.addPositionalArgument("inputs", "pbb or monosim files, or folders of vcf files to merge. With --combine, folders add all of their pbb, monosim and vcf files. Files may be compressed with gzip or zstd.", "inputs...");
+    parser.process(a);
+
+    QStringList inputs = parser.positionalArguments();
+    if (inputs.isEmpty()) parser.showHelp(1);
+
+    QTextStream errStream(stderr);
+    bool quiet = parser.isSet(quietOption);
+    bool isSingleOutput = parser.isSet(outputOption);
+    bool isStreaming = parser.isSet(streamOption);
+
+    // shards are numbered files next to the output of each input
+    int shardCards = parser.value(shardCardsOption).toInt();
+    qint64 shardBytes = parser.value(shardSizeOption).toLongLong() * 1024;
+    bool isSharded = shardCards > 0 || shardBytes > 0;
+    if (isSharded && (isSingleOutput || isStreaming)) {
+        errStream << "--shard-cards and --shard-size can't be combined with --output or --stream." << endl;
+        return 1;
+    }
+
+    // a snapshot holds the records of a single input
+    bool isSnapshot = parser.isSet(snapshotOption);
+    if (isSnapshot && (isSingleOutput || isStreaming || isSharded)) {
+        errStream << "--snapshot can't be combined with --output, --stream or sharding." << endl;
+        return 1;
+    }
+    // combined inputs end up in a single list
+    bool isCombined = parser.isSet(combineOption);
+    if (isCombined && (!isSingleOutput || isStreaming)) {
+        errStream << "--combine needs --output and can't be combined with --stream." << endl;
+        return 1;
+    }
+
+    // outputs named after their input get the suffix of the compression
+    QString compressSuffix;
+    CompressedDevice::Format compressFormat = CompressedDevice::Plain;
+    if (parser.isSet(compressOption)) {
+        compressSuffix = "." + parser.value(compressOption).toLower();
+        compressFormat = CompressedDevice::formatForPath(compressSuffix);
+        if (compressFormat == CompressedDevice::Plain) {
+            errStream << "--compress takes gz or zst." << endl;
+            return 1;
+        }
+        if (!CompressedDevice::isSupported(compressFormat)) {
+            errStream << "zstd support was not built in." << endl;
+            return 1;
+        }
+        if (isSnapshot) {
+            errStream << "--snapshot can't be combined with --compress." << endl;
+            return 1;
+        }
+    }
+    int totalFailed = 0;
+
+    ContactConverter converter;
+    converter.setMaxThreads(parser.value(jobsOption).toInt());
+    converter.setDeduplicate(parser.isSet(dedupOption));
+    if (parser.isSet(dropBinaryOption)) {
+        converter.setBinaryLimit(0);
+    } else if (parser.isSet(maxBinaryOption)) {
+        converter.setBinaryLimit(parser.value(maxBinaryOption).toInt() * 1024);
+    }
+    converter.setMergeCache(parser.isSet(cacheOption) || parser.isSet(verifyCacheOption),
+                            parser.isSet(verifyCacheOption));
+    if (parser.isSet(cacheDirOption)) converter.setCacheDirectory(parser.value(cacheDirOption));
+    QObject::connect(&converter, &ContactConverter::warning, [&errStream](const QString &message) {
+        errStream << "warning: " << message << endl;
+    });
+
+    // the watch mode runs until the process is stopped. the compression
+    // of the output follows its name.
+    if (parser.isSet(watchOption)) {
+        QString outputPath = parser.value(outputOption);
+        if (inputs.count() != 1 || !QFileInfo(inputs.first()).isDir() || !isSingleOutput || outputPath == "-" ||
+            isStreaming || isSnapshot || isSharded) {
+            errStream << "--watch takes a single folder and an --output file and can't be combined with --stream, --snapshot or sharding." << endl;
+            return 1;
+        }
+
+        FolderWatcher watcher;
+        watcher.converter()->setMaxThreads(converter.maxThreads());
+        watcher.converter()->setBinaryLimit(converter.binaryLimit());
+        watcher.setDebounceInterval(parser.value(debounceOption).toInt());
+        QObject::connect(&watcher, &FolderWatcher::warning, [&errStream](const QString &message) {
+            errStream << "warning: " << message << endl;
+        });
+        QObject::connect(&watcher, &FolderWatcher::ingested, [&](const QStringList &files, int records) {
+            if (!quiet) errStream << files.count() << " files: " << records << " records -> " << outputPath << endl;
+        });
+
+        FolderWatcher::OutputMode mode = parser.isSet(rotateOption) ? FolderWatcher::RotateOutput : FolderWatcher::AppendOutput;
+        if (!watcher.start(inputs.first(), outputPath, mode)) {
+            errStream << inputs.first() << ": " << watcher.errorString() << endl;
+            return 1;
+        }
+        if (!quiet && watcher.isPolling()) errStream << inputs.first() << ": cannot be watched, polling instead." << endl;
+        return a.exec();
+    }
+
+    QFile singleFile;
+    QScopedPointer<CompressedDevice> singleDeflater;
+    QIODevice *singleDevice = 0;
+    if (isSingleOutput) {
+        QString path = parser.value(outputOption);
+        CompressedDevice::Format format = path == "-" ? compressFormat : CompressedDevice::formatForPath(path);
+        if (!CompressedDevice::isSupported(format) ||
+            !(singleDevice = openOutput(singleFile, path, format, singleDeflater))) {
+            errStream << path << ": cannot be opened for writing." << endl;
+            return 1;
+        }
+    }
+
+    QDir outputDir;
+    if (parser.isSet(outputDirOption)) {
+        outputDir.setPath(parser.value(outputDirOption));
+        if (!outputDir.exists() && !outputDir.mkpath(".")) {
+            errStream << outputDir.path() << ": cannot be created." << endl;
+            return 1;
+        }
+    }
+
+    if (isStreaming && parser.isSet(dedupOption)) {
+        errStream << "warning: --dedup needs all records at once and is ignored with --stream." << endl;
+    }
+
+    // every input is decoded on its own thread. inputs that fail are
+    // listed together and the rest is still written.
+    if (isCombined) {
+        bool ok = converter.importFiles(inputs);
+        const QStringList fileErrors = converter.fileErrors();
+        for (int i=0; i<fileErrors.count(); i++) errStream << fileErrors.at(i) << endl;
+        totalFailed += fileErrors.count();
+
+        if (!ok) {
+            errStream << converter.errorString() << endl;
+            totalFailed++;
+        } else {
+            if (parser.isSet(reverseOption)) converter.reverseNames();
+            if (!converter.generateVCF(singleDevice)) {
+                errStream << parser.value(outputOption) << ": cannot be written." << endl;
+                totalFailed++;
+            } else if (!quiet) {
+                errStream << inputs.count() << " inputs: " << converter.records.count() << " records";
+                if (converter.duplicatesMerged() > 0) {
+                    errStream << " (" << converter.duplicatesMerged() << " duplicates merged)";
+                }
+                errStream << " -> " << parser.value(outputOption) << endl;
+            }
+        }
+    }
+
+    for (int i=0; !isCombined && i<inputs.count(); i++) {
+        // folders are named after the folder itself, files after
+        // their name without the extension
+        QString outputPath = parser.value(outputOption);
+        if (!isSingleOutput) {
+            QFileInfo fi(QDir::cleanPath(inputs[i]));
+            QString baseName = fi.isDir() ? fi.fileName() : QFileInfo(CompressedDevice::strippedPath(fi.filePath())).completeBaseName();
+            QDir dir = parser.isSet(outputDirOption) ? outputDir : fi.absoluteDir();
+            outputPath = dir.filePath(baseName + (isSnapshot ? ".vcsnap" : ".vcf" + compressSuffix));
+        }
+
+        QFile vcfFile;
+        QScopedPointer<CompressedDevice> deflater;
+        QIODevice *device = singleDevice;
+        int recordCount;
+
+        if (isStreaming) {
+            // records are written while the input is read so the output
+            // has to be opened first
+            if (!isSingleOutput && !(device = openOutput(vcfFile, outputPath, compressFormat, deflater))) {
+                errStream << outputPath << ": cannot be written." << endl;
+                totalFailed++;
+                continue;
+            }
+            if (!converter.convertFile(inputs[i], device, parser.isSet(reverseOption))) {
+                errStream << inputs[i] << ": " << converter.errorString() << endl;
+                if (!isSingleOutput) vcfFile.remove();
+                totalFailed++;
+                continue;
+            }
+            recordCount = converter.recordsConverted();
+        } else {
+            if (!converter.importFile(inputs[i])) {
+                errStream << inputs[i] << ": " << converter.errorString() << endl;
+                totalFailed++;
+                continue;
+            }
+
+            if (parser.isSet(reverseOption)) converter.reverseNames();
+
+            if (isSnapshot && !converter.saveSnapshot(outputPath)) {
+                errStream << outputPath << ": cannot be written." << endl;
+                totalFailed++;
+                continue;
+            }
+            if (isSharded && !converter.generateShards(outputPath, shardCards, shardBytes, parser.isSet(manifestOption))) {
+                errStream << outputPath << ": " << converter.errorString() << endl;
+                totalFailed++;
+                continue;
+            }
+            if (!isSnapshot && !isSharded &&
+                ((!isSingleOutput && !(device = openOutput(vcfFile, outputPath, compressFormat, deflater))) ||
+                 !converter.generateVCF(device))) {
+                errStream << outputPath << ": cannot be written." << endl;
+                totalFailed++;
+                continue;
+            }
+            recordCount = converter.records.count();
+        }
+
+        // the end of a compressed stream is only written here
+        if (deflater && !deflater->finish()) {
+            errStream << outputPath << ": cannot be written." << endl;
+            totalFailed++;
+            continue;
+        }
+        vcfFile.close();
+
+        if (!quiet) {
+            errStream << inputs[i] << ": " << recordCount << " records";
+            if (converter.duplicatesMerged() > 0) {
+                errStream << " (" << converter.duplicatesMerged() << " duplicates merged)";
+            }
+            if (isSharded) {
+                errStream << " -> " << converter.shardFiles().count() << " shards of " << outputPath << endl;
+            } else {
+                errStream << " -> " << outputPath << endl;
+            }
+        }
+    }
+
+    if (singleDeflater && !singleDeflater->finish()) {
+        errStream << parser.value(outputOption) << ": cannot be written." << endl;
+        totalFailed++;
+    }
+    singleFile.close();
+
+    if (parser.isSet(reportOption) && !converter.stageReport()->save(parser.value(reportOption))) {
+        errStream << parser.value(reportOption) << ": cannot be written." << endl;
+        return 1;
+    }
+    return totalFailed > 0 ? 1 : 0;
+}
@@ -0,0 +1,18 @@
+#-------------------------------------------------
+#
+# Headless batch converter. Shares the parsing code with the gui but
+# only links against qtcore so it runs on machines without a display.
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+TARGET = versatacts-cli
+CONFIG += console c++11
+CONFIG -= app_bundle
+TEMPLATE = app
+
+include(../versatacts-core.pri)
+
+SOURCES += main.cpp
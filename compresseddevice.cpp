@@ -0,0 +1,356 @@
+/********************************************************************
+
+Name: Versatacts
+Homepage: http://github.com/ae5chylu5/versatacts
+Author: ae5chylu5
+Description: A versatile gui application capable of extracting and
+             converting contacts to/from a variety of popular
+             mobile formats.
+
+Copyright (C) 2016 ae5chylu5
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+********************************************************************/
+
+#include "compresseddevice.h"
+
+CompressedDevice::CompressedDevice(QIODevice *source, Format format, QObject *parent)
+    : QIODevice(parent), sourceDevice(source), format(format), isStreamEnd(false),
+      isFinished(false), isFailed(false), isInitialized(false)
+{
+    memset(&zs, 0, sizeof(zs));
+#ifdef VERSATACTS_ZSTD
+    dctx = 0;
+    cctx = 0;
+    zin.src = 0;
+    zin.size = 0;
+    zin.pos = 0;
+    isFrameDone = false;
+#endif
+}
+
+CompressedDevice::~CompressedDevice()
+{
+    close();
+}
+
+// only one direction at a time, text mode is ignored
+bool CompressedDevice::open(OpenMode mode)
+{
+    bool isWrite = mode & WriteOnly;
+    if (isOpen() || ((mode & ReadOnly) && isWrite) || !(mode & ReadWrite)) return false;
+    if (format == Plain || !isSupported(format)) {
+        setErrorString(tr("The compression format is not supported."));
+        return false;
+    }
+
+    if (format == Gzip) {
+        // 15 + 32 accepts gzip and zlib headers, 15 + 16 writes gzip
+        int ret = isWrite ? deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY)
+                          : inflateInit2(&zs, 15 + 32);
+        if (ret != Z_OK) {
+            setErrorString(tr("The compression stream cannot be started."));
+            return false;
+        }
+    }
+#ifdef VERSATACTS_ZSTD
+    if (format == Zstd) {
+        if (isWrite) {
+            cctx = ZSTD_createCCtx();
+        } else {
+            dctx = ZSTD_createDCtx();
+        }
+        if (!cctx && !dctx) {
+            setErrorString(tr("The compression stream cannot be started."));
+            return false;
+        }
+    }
+#endif
+
+    isInitialized = true;
+    if (isWrite) {
+        output.resize(chunkSize);
+    } else {
+        input.resize(chunkSize);
+    }
+    return QIODevice::open(mode & ~Text);
+}
+
+// completes the stream when writing. the source device stays open.
+void CompressedDevice::close()
+{
+    if (!isOpen()) return;
+
+    bool isWrite = openMode() & WriteOnly;
+    if (isWrite) finish();
+
+    if (isInitialized && format == Gzip) {
+        if (isWrite) {
+            deflateEnd(&zs);
+        } else {
+            inflateEnd(&zs);
+        }
+    }
+#ifdef VERSATACTS_ZSTD
+    ZSTD_freeCCtx(cctx);
+    ZSTD_freeDCtx(dctx);
+    cctx = 0;
+    dctx = 0;
+#endif
+    isInitialized = false;
+    QIODevice::close();
+}
+
+bool CompressedDevice::isSequential() const
+{
+    return true;
+}
+
+bool CompressedDevice::atEnd() const
+{
+    return (isStreamEnd || isFailed) && QIODevice::atEnd();
+}
+
+// writes the end of the stream. returns false if anything couldn't be
+// written. further writes fail.
+bool CompressedDevice::finish()
+{
+    if (!(openMode() & WriteOnly) || isFinished) return !isFailed;
+
+    isFinished = true;
+    if (isFailed) return false;
+
+    if (format == Gzip) {
+        int ret;
+        zs.next_in = 0;
+        zs.avail_in = 0;
+        do {
+            zs.next_out = reinterpret_cast<Bytef *>(output.data());
+            zs.avail_out = chunkSize;
+            ret = deflate(&zs, Z_FINISH);
+            if (ret == Z_STREAM_ERROR) {
+                fail(tr("The data cannot be compressed."));
+                return false;
+            }
+            if (!writeOutput(chunkSize - zs.avail_out)) return false;
+        } while (ret != Z_STREAM_END);
+    }
+#ifdef VERSATACTS_ZSTD
+    if (format == Zstd) {
+        ZSTD_inBuffer in = {0, 0, 0};
+        size_t remaining;
+        do {
+            ZSTD_outBuffer out = {output.data(), size_t(chunkSize), 0};
+            remaining = ZSTD_compressStream2(cctx, &out, &in, ZSTD_e_end);
+            if (ZSTD_isError(remaining)) {
+                fail(tr("The data cannot be compressed."));
+                return false;
+            }
+            if (!writeOutput(int(out.pos))) return false;
+        } while (remaining != 0);
+    }
+#endif
+    return true;
+}
+
+// true once reading or writing failed. errorString() tells why.
+bool CompressedDevice::hasError() const
+{
+    return isFailed;
+}
+
+QIODevice *CompressedDevice::source() const
+{
+    return sourceDevice;
+}
+
+// files ending in .gz or .zst are compressed
+CompressedDevice::Format CompressedDevice::formatForPath(const QString &path)
+{
+    if (path.endsWith(".gz", Qt::CaseInsensitive)) return Gzip;
+    if (path.endsWith(".zst", Qt::CaseInsensitive)) return Zstd;
+    return Plain;
+}
+
+// contacts.vcf.gz becomes contacts.vcf
+QString CompressedDevice::strippedPath(const QString &path)
+{
+    switch (formatForPath(path)) {
+    case Gzip:
+        return path.left(path.length() - 3);
+    case Zstd:
+        return path.left(path.length() - 4);
+    default:
+        return path;
+    }
+}
+
+// the lowercase suffix of path without the compression, e.g. pbb for
+// contacts.pbb.gz
+QString CompressedDevice::suffix(const QString &path)
+{
+    return QFileInfo(strippedPath(path)).suffix().toLower();
+}
+
+bool CompressedDevice::isSupported(Format format)
+{
+#ifdef VERSATACTS_ZSTD
+    return true;
+#else
+    return format != Zstd;
+#endif
+}
+
+// returns 0 at the end of the stream and -1 if the data is damaged or
+// truncated
+qint64 CompressedDevice::readData(char *data, qint64 maxSize)
+{
+    if (isFailed) return -1;
+    if (isStreamEnd || maxSize <= 0) return 0;
+
+    uInt capacity = uInt(qMin(maxSize, qint64(1) << 30));
+
+    if (format == Gzip) {
+        zs.next_out = reinterpret_cast<Bytef *>(data);
+        zs.avail_out = capacity;
+        while (zs.avail_out > 0) {
+            if (zs.avail_in == 0 && !fillInput()) {
+                if (!isFailed) fail(tr("The compressed data is truncated."));
+                return -1;
+            }
+
+            int ret = inflate(&zs, Z_NO_FLUSH);
+            if (ret == Z_STREAM_END) {
+                // concatenated gzip members continue the same text
+                if (zs.avail_in == 0 && !fillInput()) {
+                    if (isFailed) return -1;
+                    isStreamEnd = true;
+                    break;
+                }
+                inflateReset(&zs);
+                continue;
+            }
+            if (ret != Z_OK && ret != Z_BUF_ERROR) {
+                fail(tr("The compressed data is damaged."));
+                return -1;
+            }
+        }
+        return capacity - zs.avail_out;
+    }
+
+#ifdef VERSATACTS_ZSTD
+    ZSTD_outBuffer out = {data, size_t(capacity), 0};
+    while (out.pos < out.size) {
+        if (zin.pos == zin.size && !fillInput()) {
+            if (isFailed) return -1;
+            // the data has to end with a complete frame
+            if (!isFrameDone) {
+                fail(tr("The compressed data is truncated."));
+                return -1;
+            }
+            isStreamEnd = true;
+            break;
+        }
+
+        size_t ret = ZSTD_decompressStream(dctx, &out, &zin);
+        if (ZSTD_isError(ret)) {
+            fail(tr("The compressed data is damaged."));
+            return -1;
+        }
+        isFrameDone = ret == 0;
+    }
+    return qint64(out.pos);
+#else
+    return -1;
+#endif
+}
+
+qint64 CompressedDevice::writeData(const char *data, qint64 size)
+{
+    if (isFailed || isFinished) return -1;
+
+    qint64 done = 0;
+    while (done < size) {
+        uInt piece = uInt(qMin(size - done, qint64(chunkSize)));
+
+        if (format == Gzip) {
+            zs.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data + done));
+            zs.avail_in = piece;
+            do {
+                zs.next_out = reinterpret_cast<Bytef *>(output.data());
+                zs.avail_out = chunkSize;
+                if (deflate(&zs, Z_NO_FLUSH) == Z_STREAM_ERROR) {
+                    fail(tr("The data cannot be compressed."));
+                    return -1;
+                }
+                if (!writeOutput(chunkSize - zs.avail_out)) return -1;
+            } while (zs.avail_out == 0);
+        }
+#ifdef VERSATACTS_ZSTD
+        if (format == Zstd) {
+            ZSTD_inBuffer in = {data + done, size_t(piece), 0};
+            while (in.pos < in.size) {
+                ZSTD_outBuffer out = {output.data(), size_t(chunkSize), 0};
+                size_t ret = ZSTD_compressStream2(cctx, &out, &in, ZSTD_e_continue);
+                if (ZSTD_isError(ret)) {
+                    fail(tr("The data cannot be compressed."));
+                    return -1;
+                }
+                if (!writeOutput(int(out.pos))) return -1;
+            }
+        }
+#endif
+        done += piece;
+    }
+    return size;
+}
+
+// reads the next chunk of compressed data. returns false at the end of
+// the source or if it can't be read.
+bool CompressedDevice::fillInput()
+{
+    qint64 length = sourceDevice->read(input.data(), chunkSize);
+    if (length < 0) {
+        fail(tr("The input cannot be read."));
+        return false;
+    }
+    if (length == 0) return false;
+
+    if (format == Gzip) {
+        zs.next_in = reinterpret_cast<Bytef *>(input.data());
+        zs.avail_in = uInt(length);
+    }
+#ifdef VERSATACTS_ZSTD
+    zin.src = input.constData();
+    zin.size = size_t(length);
+    zin.pos = 0;
+#endif
+    return true;
+}
+
+bool CompressedDevice::writeOutput(int length)
+{
+    if (length == 0) return true;
+    if (sourceDevice->write(output.constData(), length) == length) return true;
+
+    fail(tr("The output cannot be written."));
+    return false;
+}
+
+void CompressedDevice::fail(const QString &message)
+{
+    isFailed = true;
+    setErrorString(message);
+}
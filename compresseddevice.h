@@ -0,0 +1,100 @@
+/********************************************************************
+
+Name: Versatacts
+Homepage: http://github.com/ae5chylu5/versatacts
+Author: ae5chylu5
+Description: A versatile gui application capable of extracting and
+             converting contacts to/from a variety of popular
+             mobile formats.
+
+Copyright (C) 2016 ae5chylu5
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+********************************************************************/
+
+#ifndef COMPRESSEDDEVICE_H
+#define COMPRESSEDDEVICE_H
+
+#include <QByteArray>
+#include <QFileInfo>
+#include <QIODevice>
+#include <QString>
+
+#include <string.h>
+#include <zlib.h>
+
+#ifdef VERSATACTS_ZSTD
+#include <zstd.h>
+#endif
+
+// CompressedDevice inflates or deflates another device as it is read or
+// written so compressed dumps never have to be unpacked to disk. only a
+// chunk of compressed data is held in memory at any time.
+//
+// gzip is always available. zstd needs libzstd and is only built when
+// qmake is run with CONFIG+=zstd. the source device must already be
+// open. finish() has to be called after writing to complete the stream.
+class CompressedDevice : public QIODevice
+{
+    Q_OBJECT
+
+public:
+    enum Format {
+        Plain,
+        Gzip,
+        Zstd
+    };
+
+    CompressedDevice(QIODevice *source, Format format, QObject *parent = 0);
+    ~CompressedDevice();
+    bool open(OpenMode mode);
+    void close();
+    bool isSequential() const;
+    bool atEnd() const;
+    bool finish();
+    bool hasError() const;
+    QIODevice *source() const;
+    static Format formatForPath(const QString &path);
+    static QString strippedPath(const QString &path);
+    static QString suffix(const QString &path);
+    static bool isSupported(Format format);
+
+protected:
+    qint64 readData(char *data, qint64 maxSize);
+    qint64 writeData(const char *data, qint64 size);
+
+private:
+    static const int chunkSize = 256 * 1024; // compressed bytes read or written at once
+    bool fillInput();
+    bool writeOutput(int length);
+    void fail(const QString &message);
+    QIODevice *sourceDevice;
+    Format format;
+    QByteArray input;
+    QByteArray output;
+    bool isStreamEnd;
+    bool isFinished;
+    bool isFailed;
+    bool isInitialized;
+    z_stream zs;
+#ifdef VERSATACTS_ZSTD
+    ZSTD_DCtx *dctx;
+    ZSTD_CCtx *cctx;
+    ZSTD_inBuffer zin;
+    bool isFrameDone; // the last frame was decoded completely
+#endif
+};
+
+#endif // COMPRESSEDDEVICE_H
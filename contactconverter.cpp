@@ -0,0 +1,1673 @@
+/********************************************************************
+
+Name: Versatacts
+Homepage: http://github.com/ae5chylu5/versatacts
+Author: ae5chylu5
+Description: A versatile gui application capable of extracting and
+             converting contacts to/from a variety of popular
+             mobile formats.
+
+Copyright (C) 2016 ae5chylu5
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+********************************************************************/
+
+#include "contactconverter.h"
+
+ContactConverter::ContactConverter(QObject *parent)
+    : QObject(parent)
+{
+    totalRecords = -1;
+    threadLimit = 0;
+    cacheEnabled = false;
+    cacheHashEnabled = false;
+    cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    dedupEnabled = false;
+    maxBinarySize = -1;
+    mergedDuplicates = 0;
+    streamedRecords = 0;
+    canceled.store(0);
+}
+
+ContactConverter::~ContactConverter()
+{
+
+}
+
+void ContactConverter::cancel()
+{
+    canceled.store(1);
+}
+
+// clears a cancel request. called once when an operation the user
+// started begins, never by the stages themselves, so a cancel arriving
+// between two stages stops the rest of the operation.
+void ContactConverter::resetCancel()
+{
+    canceled.store(0);
+}
+
+bool ContactConverter::isCanceled() const
+{
+    return canceled.load() != 0;
+}
+
+// limits the number of worker threads. 0 uses one thread per core.
+void ContactConverter::setMaxThreads(int count)
+{
+    threadLimit = count;
+}
+
+int ContactConverter::maxThreads() const
+{
+    return threadLimit > 0 ? threadLimit : QThread::idealThreadCount();
+}
+
+// keeps the records of merged folders in a cache so a re-merge only
+// parses new or changed files. with verifyContents the files are also
+// compared by a hash of their contents instead of size and mtime alone.
+void ContactConverter::setMergeCache(bool enabled, bool verifyContents)
+{
+    cacheEnabled = enabled;
+    cacheHashEnabled = verifyContents;
+}
+
+void ContactConverter::setCacheDirectory(const QString &path)
+{
+    cacheDir = path;
+}
+
+// collapses duplicate contacts at the end of every import
+void ContactConverter::setDeduplicate(bool enabled)
+{
+    dedupEnabled = enabled;
+}
+
+// the number of records the last import merged into others
+int ContactConverter::duplicatesMerged() const
+{
+    return mergedDuplicates;
+}
+
+// photos, logos, sounds and keys of merged vcf files larger than bytes
+// are dropped. 0 drops all of them and -1 keeps them whatever their size.
+void ContactConverter::setBinaryLimit(int bytes)
+{
+    maxBinarySize = bytes;
+}
+
+int ContactConverter::binaryLimit() const
+{
+    return maxBinarySize;
+}
+
+// timings and counters of every stage run so far
+StageReport *ContactConverter::stageReport()
+{
+    return &report;
+}
+
+// covers the records of the last importFile(). it must not be used
+// while an import is running.
+ContactIndex *ContactConverter::searchIndex()
+{
+    return &index;
+}
+
+// the records matching text. records the index hasn't seen yet are only
+// indexed here if indexRecords() wasn't called after the import.
+QVector<int> ContactConverter::findRecords(const QString &text)
+{
+    indexRecords();
+    return index.find(text);
+}
+
+// indexes the records the index hasn't seen yet, e.g. those of a
+// snapshot which importFile() leaves unindexed. callers that search run
+// this on a worker thread after the import so the first search doesn't
+// have to.
+void ContactConverter::indexRecords()
+{
+    if (index.count() != records.count()) buildIndex();
+}
+
+void ContactConverter::startProgress(const QString &label, int maximum)
+{
+    progressTimer.start();
+    emit progressStarted(label, maximum);
+}
+
+// the stages usually run on a worker thread so progress reaches the gui
+// through queued signals. only report it every few milliseconds so
+// neither side spends more time on progress than on the actual work.
+void ContactConverter::reportProgress(int value)
+{
+    if (progressTimer.elapsed() < progressInterval) return;
+    progressTimer.restart();
+    emit progressChanged(value);
+}
+
+void ContactConverter::finishProgress(int maximum)
+{
+    emit progressChanged(maximum);
+    emit progressFinished();
+}
+
+QString ContactConverter::errorString() const
+{
+    return lastError;
+}
+
+bool ContactConverter::importFile(const QString &path)
+{
+    // the first few kilobytes tell the format so renamed files work too
+    QFileInfo fi(path);
+    return importFile(path, fi.isFile() ? FormatSniffer::formatForFile(path) : FormatSniffer::Unknown);
+}
+
+// imports a file whose format the caller already sniffed. type is
+// ignored for folders.
+bool ContactConverter::importFile(const QString &path, FormatSniffer::Format type)
+{
+    records.clear();
+    index.clear();
+    lastError.clear();
+    failedFiles.clear();
+    mergedDuplicates = 0;
+    currentInput = path;
+
+    // the compression goes by the file name. contacts.pbb.gz is a
+    // compressed pbb file.
+    QFile contactsFile(path);
+    QFileInfo fi(contactsFile);
+    CompressedDevice::Format format = CompressedDevice::formatForPath(path);
+
+    if (!contactsFile.exists()) {
+        lastError = tr("The input source cannot be found.");
+        return false;
+    }
+
+    if (fi.isDir()) {
+        mergeRecords(path);
+        if (dedupEnabled) deduplicateRecords();
+        buildIndex();
+        return true;
+    }
+
+    if (!CompressedDevice::isSupported(format)) {
+        lastError = tr("The compression format is not supported.");
+        return false;
+    }
+
+    // snapshots hold records that were already imported and sanitized.
+    // they are mapped so they can't be compressed. indexing would read
+    // every name and number so it waits for the first search.
+    if (type == FormatSniffer::Snapshot && format == CompressedDevice::Plain) {
+        if (!loadSnapshot(path)) {
+            lastError = tr("The snapshot is damaged or was written by another version.");
+            return false;
+        }
+        if (dedupEnabled) deduplicateRecords();
+        return true;
+    }
+
+    // a single vcf file is parsed like the files of a merged folder
+    if (type == FormatSniffer::Vcf) {
+        StageReport::Stage stage("importVcf", path);
+        if (!parseVcf(path, &records)) {
+            records.clear();
+            lastError = tr("The input source cannot be opened.");
+            return false;
+        }
+        stage.count("bytes", fi.size());
+        stage.count("records", records.count());
+        report.add(stage);
+        if (dedupEnabled) deduplicateRecords();
+        buildIndex();
+        return true;
+    }
+
+    if (type != FormatSniffer::Monosim && type != FormatSniffer::Pbb) {
+        lastError = tr("The input source is not a supported format.");
+        return false;
+    }
+
+    if (!contactsFile.open(QIODevice::ReadOnly)) {
+        lastError = tr("The input source cannot be opened.");
+        return false;
+    }
+
+    // compressed files are inflated while they are decoded
+    CompressedDevice inflater(&contactsFile, format);
+    QIODevice *input = &contactsFile;
+    if (format != CompressedDevice::Plain) {
+        if (!inflater.open(QIODevice::ReadOnly)) {
+            lastError = tr("The input source cannot be opened.");
+            return false;
+        }
+        input = &inflater;
+    }
+
+    if (type == FormatSniffer::Monosim) {
+        importMonosim(input);
+    } else {
+        importPBB(input);
+        if (!inflater.hasError()) sanitizeRecords();
+    }
+
+    if (inflater.hasError()) {
+        records.clear();
+        lastError = inflater.errorString();
+        return false;
+    }
+
+    inflater.close();
+    contactsFile.close();
+    if (dedupEnabled) deduplicateRecords();
+    buildIndex();
+    return true;
+}
+
+void ContactConverter::mergeRecords(const QString &path)
+{
+    QDir dir(path);
+    dir.setFilter(QDir::Files);
+    const QStringList fileList = dir.entryList();
+    const QString prefix = path + QDir::separator();
+    int fileCount = fileList.count();
+    StageReport::Stage stage("mergeRecords", path);
+    qint64 bytesRead = 0;
+    int skippedFiles = 0;
+
+    records.clear();
+
+    startProgress(tr("Importing contacts"), fileCount);
+
+    // files that haven't changed since the last merge of this folder
+    // are taken from the cache instead of being parsed again
+    MergeCache *cache = 0;
+    QString cachePath;
+    if (cacheEnabled) {
+        cache = new MergeCache;
+        cachePath = MergeCache::cachePath(cacheDir, path,
+                                          maxBinarySize < 0 ? QString() : "binary" + QString::number(maxBinarySize));
+        cache->load(cachePath);
+        if (!cache->beginWrite(cachePath)) emit warning(cachePath + tr(" cannot be written."));
+    }
+
+    // every file is parsed into its own store on the worker threads.
+    // they are appended here in entryList order so the result is the
+    // same as parsing the files one after another.
+    QVector<ContactStore *> results(fileCount, 0);
+    QVector<int> states(fileCount, FilePending);
+    QVector<qint64> sizes(fileCount, 0);
+    QVector<qint64> modified(fileCount, 0);
+    QVector<QByteArray> hashes(fileCount);
+    QVector<QString> errors(fileCount);
+    QAtomicInt nextFile(0);
+    QAtomicInt cachedFiles(0);
+    QMutex mutex;
+    QWaitCondition fileDone;
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(qMax(1, qMin(maxThreads(), fileCount)));
+    for (int t=0; t<pool.maxThreadCount(); t++) {
+        QtConcurrent::run(&pool, [&]() {
+            int i;
+            while (!canceled.load() && (i = nextFile.fetchAndAddRelaxed(1)) < fileCount) {
+                QString filePath = prefix + fileList.at(i);
+                QFileInfo fi(filePath);
+                qint64 fileSize = fi.size();
+                qint64 fileModified = fi.lastModified().toMSecsSinceEpoch();
+                QByteArray hash = (cache && cacheHashEnabled) ? MergeCache::fileHash(filePath) : QByteArray();
+                ContactStore *store = 0;
+                QString error;
+                bool ok = true;
+
+                if (cache) {
+                    QMutexLocker locker(&mutex);
+                    store = cache->take(fileList.at(i), fileSize, fileModified, hash);
+                    if (store) cachedFiles.ref();
+                }
+
+                // a file missing from the cache is sniffed, its name
+                // doesn't tell the format. cached files were sniffed
+                // when they were parsed, so they aren't read again.
+                if (!store) {
+                    FormatSniffer::Format type = FormatSniffer::formatForFile(filePath);
+                    if (type == FormatSniffer::Unknown) {
+                        QMutexLocker locker(&mutex);
+                        states[i] = FileSkipped;
+                        fileDone.wakeAll();
+                        continue;
+                    }
+                    store = new ContactStore;
+                    ok = parseFile(filePath, type, store, &error);
+                }
+
+                QMutexLocker locker(&mutex);
+                results[i] = store;
+                errors[i] = error;
+                sizes[i] = fileSize;
+                modified[i] = fileModified;
+                hashes[i] = hash;
+                states[i] = ok ? FileParsed : FileFailed;
+                fileDone.wakeAll();
+            }
+        });
+    }
+
+    int i = 0;
+    int state;
+    ContactStore *store;
+    while (i < fileCount) {
+        mutex.lock();
+        if (states.at(i) == FilePending) fileDone.wait(&mutex, 50);
+        state = states.at(i);
+        store = results.at(i);
+        results[i] = 0;
+        mutex.unlock();
+
+        // keep the progress moving while waiting so a cancel request
+        // gets through even if a single file takes long
+        reportProgress(i);
+        if (canceled.load()) {
+            delete store;
+            break;
+        }
+        if (state == FilePending) continue;
+        if (state == FileSkipped) {
+            skippedFiles++;
+            i++;
+            continue;
+        }
+
+        if (state == FileFailed) {
+            emit warning(fileList.at(i) + ": " + errors.at(i));
+        } else {
+            bytesRead += sizes.at(i);
+        }
+        if (state == FileParsed && cache) {
+            mutex.lock();
+            cache->write(fileList.at(i), sizes.at(i), modified.at(i), hashes.at(i), *store);
+            mutex.unlock();
+        }
+        records.append(*store);
+        delete store;
+        i++;
+
+        // the keys are collected while the workers parse the next files
+        index.add(records);
+    }
+
+    pool.waitForDone();
+    qDeleteAll(results);
+
+    // a cancelled merge leaves the previous cache in place
+    if (cache && !canceled.load()) cache->commit();
+    delete cache;
+
+    finishProgress(fileCount);
+
+    stage.count("files", fileCount);
+    stage.count("skippedFiles", skippedFiles);
+    stage.count("cachedFiles", cachedFiles.load());
+    stage.count("bytes", bytesRead);
+    stage.count("records", records.count());
+    report.add(stage);
+}
+
+// imports a selection of files at once. folders add the pbb, monosim and
+// vcf files they hold in name order. every file is decoded into its own
+// store on the worker threads and the stores are appended in the given
+// order, so the result is the same as importing the files one after
+// another. files that fail are listed in fileErrors() and skipped.
+// returns false if none of the files could be imported.
+bool ContactConverter::importFiles(const QStringList &paths)
+{
+    records.clear();
+    index.clear();
+    lastError.clear();
+    failedFiles.clear();
+    mergedDuplicates = 0;
+    currentInput = paths.join(", ");
+
+    // the files of a folder are only imported if their format is known
+    QStringList fileList;
+    QVector<bool> isListed;
+    for (int i=0; i<paths.count(); i++) {
+        QFileInfo fi(paths.at(i));
+        if (!fi.isDir()) {
+            fileList << paths.at(i);
+            isListed << true;
+            continue;
+        }
+        QDir dir(paths.at(i));
+        dir.setFilter(QDir::Files);
+        const QStringList entries = dir.entryList();
+        for (int j=0; j<entries.count(); j++) {
+            fileList << dir.filePath(entries.at(j));
+            isListed << false;
+        }
+    }
+
+    int fileCount = fileList.count();
+    StageReport::Stage stage("importFiles", currentInput);
+    qint64 bytesRead = 0;
+    int failedCount = 0;
+    int skippedFiles = 0;
+
+    startProgress(tr("Importing contacts"), fileCount);
+
+    QVector<ContactStore *> results(fileCount, 0);
+    QVector<int> states(fileCount, FilePending);
+    QVector<QString> errors(fileCount);
+    QAtomicInt nextFile(0);
+    QMutex mutex;
+    QWaitCondition fileDone;
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(qMax(1, qMin(maxThreads(), fileCount)));
+    for (int t=0; t<pool.maxThreadCount(); t++) {
+        QtConcurrent::run(&pool, [&]() {
+            int i;
+            while (!canceled.load() && (i = nextFile.fetchAndAddRelaxed(1)) < fileCount) {
+                // the format is sniffed once and handed to the decoder
+                FormatSniffer::Format type = FormatSniffer::formatForFile(fileList.at(i));
+                if (type == FormatSniffer::Unknown && !isListed.at(i)) {
+                    QMutexLocker locker(&mutex);
+                    states[i] = FileSkipped;
+                    fileDone.wakeAll();
+                    continue;
+                }
+
+                ContactStore *store = new ContactStore;
+                QString error;
+                bool ok = parseFile(fileList.at(i), type, store, &error);
+
+                QMutexLocker locker(&mutex);
+                results[i] = store;
+                errors[i] = error;
+                states[i] = ok ? FileParsed : FileFailed;
+                fileDone.wakeAll();
+            }
+        });
+    }
+
+    int i = 0;
+    int state;
+    ContactStore *store;
+    while (i < fileCount) {
+        mutex.lock();
+        if (states.at(i) == FilePending) fileDone.wait(&mutex, 50);
+        state = states.at(i);
+        store = results.at(i);
+        results[i] = 0;
+        mutex.unlock();
+
+        reportProgress(i);
+        if (canceled.load()) {
+            delete store;
+            break;
+        }
+        if (state == FilePending) continue;
+        if (state == FileSkipped) {
+            skippedFiles++;
+            i++;
+            continue;
+        }
+
+        // failures are collected instead of stopping the import so the
+        // caller can list them all at once
+        if (state == FileFailed) {
+            failedFiles << QFileInfo(fileList.at(i)).fileName() + ": " + errors.at(i);
+            failedCount++;
+        } else {
+            bytesRead += QFileInfo(fileList.at(i)).size();
+            records.append(*store);
+        }
+        delete store;
+        i++;
+
+        index.add(records);
+    }
+
+    pool.waitForDone();
+    qDeleteAll(results);
+
+    finishProgress(fileCount);
+    totalRecords = records.count();
+
+    stage.count("files", fileCount);
+    stage.count("failedFiles", failedCount);
+    stage.count("skippedFiles", skippedFiles);
+    stage.count("bytes", bytesRead);
+    stage.count("records", records.count());
+    report.add(stage);
+
+    if (failedCount + skippedFiles == fileCount) {
+        lastError = failedCount == 0 ? tr("The input source holds no supported files.")
+                                   : tr("None of the input sources could be imported.");
+        return false;
+    }
+
+    if (dedupEnabled) deduplicateRecords();
+    buildIndex();
+    return true;
+}
+
+// the reasons the files of the last importFiles() call were skipped
+QStringList ContactConverter::fileErrors() const
+{
+    return failedFiles;
+}
+
+// decodes a single file of the given format into store the same way
+// importFile() would. this runs on the import worker threads so it must
+// not touch anything but its arguments.
+bool ContactConverter::parseFile(const QString &path, FormatSniffer::Format type, ContactStore *store, QString *error) const
+{
+    CompressedDevice::Format format = CompressedDevice::formatForPath(path);
+    QFile contactsFile(path);
+
+    if (!contactsFile.exists()) {
+        *error = tr("The input source cannot be found.");
+        return false;
+    }
+    if (type == FormatSniffer::Unknown) {
+        *error = tr("The input source is not a supported format.");
+        return false;
+    }
+    if (!CompressedDevice::isSupported(format)) {
+        *error = tr("The compression format is not supported.");
+        return false;
+    }
+
+    if (type == FormatSniffer::Snapshot) {
+        if (format == CompressedDevice::Plain && ContactSnapshot::load(path, store)) return true;
+        *error = tr("The snapshot is damaged or was written by another version.");
+        return false;
+    }
+
+    if (type == FormatSniffer::Vcf) {
+        if (parseVcf(path, store)) return true;
+        *error = tr("The input source cannot be opened.");
+        return false;
+    }
+
+    if (!contactsFile.open(QIODevice::ReadOnly)) {
+        *error = tr("The input source cannot be opened.");
+        return false;
+    }
+
+    CompressedDevice inflater(&contactsFile, format);
+    QIODevice *input = &contactsFile;
+    if (format != CompressedDevice::Plain) {
+        if (!inflater.open(QIODevice::ReadOnly)) {
+            *error = tr("The input source cannot be opened.");
+            return false;
+        }
+        input = &inflater;
+    }
+
+    if (type == FormatSniffer::Monosim) {
+        decodeMonosim(input, [&](const QString &line, qint64) {
+            addMonosimLine(line, store);
+            return !canceled.load();
+        });
+        store->discardRecord();
+    } else {
+        PbbDecoder decoder;
+        decodePbb(input, decoder, [&](const QStringList &record, qint64) {
+            store->addRecord(record);
+            sanitizeRecord(*store, store->count() - 1);
+            return !canceled.load();
+        });
+    }
+
+    if (inflater.hasError()) {
+        *error = inflater.errorString();
+        return false;
+    }
+    return true;
+}
+
+// parses a single vcf file into store. this runs on the merge worker
+// threads so it must not touch anything but its arguments.
+bool ContactConverter::parseVcf(const QString &path, ContactStore *store) const
+{
+    QFile contactsFile(path);
+    if (!contactsFile.exists() || !contactsFile.open(QIODevice::ReadOnly)) return false;
+
+    // compressed files are inflated a chunk at a time
+    CompressedDevice::Format format = CompressedDevice::formatForPath(path);
+    if (format != CompressedDevice::Plain) {
+        CompressedDevice inflater(&contactsFile, format);
+        return inflater.open(QIODevice::ReadOnly) && parseVcfStream(&inflater, store);
+    }
+
+    // the reader works on the raw bytes so map the file when possible
+    qint64 size = contactsFile.size();
+    uchar *mapped = size > 0 ? contactsFile.map(0, size) : 0;
+    QByteArray buffer;
+    if (!mapped) buffer = contactsFile.readAll();
+    if (!mapped) size = buffer.size();
+
+    QByteArray transcoded;
+    TextDecoder::Encoding encoding;
+    const char *bytes = vcfText(mapped ? reinterpret_cast<const char *>(mapped) : buffer.constData(),
+                                &size, &encoding, &transcoded);
+    parseVcfText(bytes, size, encoding, store);
+
+    if (mapped) contactsFile.unmap(mapped);
+    contactsFile.close();
+    return true;
+}
+
+// parses a vcf file that can only be read in order. returns false if
+// the data is damaged.
+bool ContactConverter::parseVcfStream(QIODevice *device, ContactStore *store) const
+{
+    decodeVcf(device, [&](const char *bytes, qint64 size, TextDecoder::Encoding encoding, qint64) {
+        parseVcfText(bytes, size, encoding, store);
+        return !canceled.load();
+    });
+
+    CompressedDevice *inflater = qobject_cast<CompressedDevice *>(device);
+    return !inflater || !inflater->hasError();
+}
+
+// hands the 8 bit text of a vcf file to handle in pieces of about
+// inputChunkSize along with the position in the file, until handle
+// returns false. the text is cut in front of the last card of every
+// chunk so the reader only ever sees complete cards.
+void ContactConverter::decodeVcf(QIODevice *device,
+                                 const std::function<bool(const char *, qint64, TextDecoder::Encoding, qint64)> &handle)
+{
+    QByteArray buffer;
+    QByteArray chunk;
+    QByteArray transcoded;
+    TextDecoder::Encoding encoding = TextDecoder::Utf8;
+    bool isFirst = true;
+    bool isFinal = false;
+    bool isOpen = true;
+    int cut;
+
+    while (isOpen && !isFinal) {
+        chunk = device->read(inputChunkSize);
+        isFinal = chunk.size() < inputChunkSize;
+        buffer.append(chunk);
+
+        // utf-16 has no ascii BEGIN so such a file is only cut at its end
+        cut = isFinal ? buffer.size() : lastCardStart(buffer);
+        if (cut <= 0) continue;
+
+        // the encoding is detected on the first piece and kept for the rest
+        qint64 size = cut;
+        const char *bytes = buffer.constData();
+        if (isFirst) {
+            bytes = vcfText(bytes, &size, &encoding, &transcoded);
+            isFirst = false;
+        }
+        isOpen = handle(bytes, size, encoding, sourcePosition(device));
+        transcoded.clear();
+        buffer.remove(0, cut);
+    }
+}
+
+// the offset of the last line starting with BEGIN:VCARD other than the
+// first one. 0 if there is none.
+int ContactConverter::lastCardStart(const QByteArray &buffer)
+{
+    const char *data = buffer.constData();
+    for (int i=buffer.size()-11; i>0; i--) {
+        if (data[i - 1] == '\n' && qstrnicmp(data + i, "BEGIN:VCARD", 11) == 0) return i;
+    }
+    return 0;
+}
+
+// the encoding is detected once for a whole file and the byte order mark
+// is skipped. the reader only understands 8 bit text so utf-16 is
+// converted to utf-8 into transcoded.
+const char *ContactConverter::vcfText(const char *data, qint64 *size, TextDecoder::Encoding *encoding, QByteArray *transcoded)
+{
+    int bomLength;
+    *encoding = TextDecoder::detect(data, *size, &bomLength);
+    data += bomLength;
+    *size -= bomLength;
+    if (*encoding == TextDecoder::Utf16LE || *encoding == TextDecoder::Utf16BE) {
+        *transcoded = TextDecoder::decode(data, *size, *encoding).toUtf8();
+        *encoding = TextDecoder::Utf8;
+        *size = transcoded->size();
+        return transcoded->constData();
+    }
+    return data;
+}
+
+// adds the cards of the 8 bit text to store
+void ContactConverter::parseVcfText(const char *bytes, qint64 size, TextDecoder::Encoding encoding, ContactStore *store) const
+{
+    VcardReader reader(bytes, size);
+    reader.setTextEncoding(encoding);
+    VcardReader::Property property;
+    QStringList names;
+    QString fullName;
+    bool isCard = false;
+    bool hasName = false;
+
+    // the names always come first in a record. FN is only used when the
+    // card has no N property, which vcard 4.0 no longer requires.
+    auto finishCard = [&]() {
+        if (!hasName && !fullName.isEmpty()) {
+            // we don't attempt to detect names other than first, last.
+            // the first word is the first name and the remaining are
+            // joined as the last name. it won't always be accurate but
+            // the reverse names feature can fix it.
+            names = fullName.split(" ", QString::SkipEmptyParts);
+            if (!names.isEmpty()) {
+                store->insertField(0, ContactStore::FirstName, names.takeFirst());
+                if (!names.isEmpty()) store->insertField(1, ContactStore::LastName, names.join(" "));
+            }
+        }
+        store->endRecord();
+    };
+
+    while (reader.readProperty(property)) {
+        if (canceled.load()) break;
+
+        if (property.name.equals("BEGIN")) {
+            // a card without END is closed by the next one
+            if (isCard) finishCard();
+            isCard = true;
+            hasName = false;
+            fullName.clear();
+            continue;
+        }
+
+        // anything outside of a card is ignored
+        if (!isCard || property.name.equals("VERSION")) continue;
+
+        if (property.name.equals("END")) {
+            finishCard();
+            isCard = false;
+            continue;
+        }
+
+        // N is family;given;additional;prefix;suffix
+        if (property.name.equals("N")) {
+            if (hasName) continue;
+            names = VcardReader::components(reader.decodedValue(property));
+            QString lastName = names.value(0).trimmed();
+            QString firstName = names.value(1).trimmed();
+            QString additional = names.value(2).replace(QLatin1Char(','), QLatin1Char(' ')).trimmed();
+            if (!additional.isEmpty()) firstName = (firstName + " " + additional).trimmed();
+            if (firstName.isEmpty() && lastName.isEmpty()) continue;
+
+            store->insertField(0, ContactStore::FirstName, firstName);
+            if (!lastName.isEmpty()) store->insertField(1, ContactStore::LastName, lastName);
+            hasName = true;
+            continue;
+        }
+
+        if (property.name.equals("FN")) {
+            fullName = VcardReader::unescaped(reader.decodedValue(property)).trimmed();
+            continue;
+        }
+
+        // binary values are copied as bytes and never decoded
+        if (isBinary(property)) {
+            if (maxBinarySize < 0 || property.line.length <= maxBinarySize) {
+                store->addBinaryField(property.line.data, property.line.length);
+            }
+            continue;
+        }
+
+        store->addField(ContactStore::Raw, reader.textLine(property));
+    }
+
+    // the last card of a truncated file
+    if (isCard) finishCard();
+}
+
+// inline photos, logos, sounds and keys. vcard 2.1 and 3.0 encode them
+// as base64, 4.0 as data uris. plain uris stay text.
+bool ContactConverter::isBinary(const VcardReader::Property &property)
+{
+    if (!property.name.equals("PHOTO") && !property.name.equals("LOGO") &&
+        !property.name.equals("SOUND") && !property.name.equals("KEY")) return false;
+
+    VcardReader::View encoding = VcardReader::paramValue(property.params, "ENCODING");
+    return encoding.equals("b") || encoding.equals("BASE64") ||
+           property.params.contains("BASE64") ||
+           (property.value.length > 5 && qstrnicmp(property.value.data, "data:", 5) == 0);
+}
+
+void ContactConverter::importMonosim(QIODevice *file)
+{
+    qint64 lineCount = 0;
+    StageReport::Stage stage("importMonosim", currentInput);
+
+    // records is a public list so always clear it
+    records.clear();
+
+    qint64 size = sourceSize(file);
+    startProgress(tr("Importing contacts"), size);
+
+    decodeMonosim(file, [&](const QString &line, qint64 position) {
+        lineCount++;
+
+        reportProgress(position);
+        if (canceled.load()) return false;
+
+        addMonosimLine(line, &records);
+        return true;
+    });
+
+    // names without a phone number after them are not a complete record
+    records.discardRecord();
+
+    finishProgress(size);
+
+    stage.count("bytes", size);
+    stage.count("lines", lineCount);
+    stage.count("records", records.count());
+    report.add(stage);
+}
+
+// hands every line of a monosim file to handle along with the position
+// in the file, until handle returns false. the encoding is worked out
+// once for the whole file. a plain file is mapped and decoded in one go.
+// anything else, e.g. a compressed file, is decoded in chunks of
+// inputChunkSize and a line cut off by the end of a chunk is finished
+// with the next one.
+void ContactConverter::decodeMonosim(QIODevice *device, const std::function<bool(const QString &, qint64)> &handle)
+{
+    QString line;
+    QFile *file = qobject_cast<QFile *>(device);
+    qint64 size = device->size();
+    uchar *mapped = (file && size > 0) ? file->map(0, size) : 0;
+
+    if (mapped) {
+        TextDecoder decoder(reinterpret_cast<const char *>(mapped), size);
+        while (decoder.readLine(line) && handle(line, decoder.position())) {}
+        file->unmap(mapped);
+        return;
+    }
+
+    TextDecoder decoder;
+    QByteArray buffer;
+    QByteArray chunk;
+    bool isFinal = false;
+    bool isOpen = true;
+    while (isOpen && !isFinal) {
+        chunk = device->read(inputChunkSize);
+        isFinal = chunk.size() < inputChunkSize;
+        buffer.append(chunk);
+        decoder.setData(buffer.constData(), buffer.size(), isFinal);
+        while (isOpen && decoder.readLine(line)) isOpen = handle(line, sourcePosition(device));
+        buffer.remove(0, int(decoder.position()));
+    }
+}
+
+// a monosim file alternates between a line with the names and a line
+// with the phone number which completes the record. returns true once
+// a record is complete.
+bool ContactConverter::addMonosimLine(QString line, ContactStore *store)
+{
+    QStringList names;
+
+    // remove whitespace at beginning and end of line
+    line = line.trimmed();
+
+    if (line.isEmpty()) return false;
+
+    if (FieldClassifier::isPhone(line)) {
+        store->addField(ContactStore::Tel, line, ContactStore::Cell);
+        store->endRecord();
+        return true;
+    } else {
+        names = line.split(" ", QString::SkipEmptyParts);
+        store->addField(ContactStore::FirstName, names[0]);
+        // we don't attempt to detect names other than first, last.
+        // so we pop the first since it was saved above and join
+        // the remaining as the last name. it won't always be
+        // accurate but the reverse names feature can fix it.
+        names.pop_front();
+        if (names.count() > 0) store->addField(ContactStore::LastName, names.join(" "));
+    }
+    return false;
+}
+
+void ContactConverter::importPBB(QIODevice *pbbFile)
+{
+    qint64 valueCount = 0;
+    StageReport::Stage stage("importPBB", currentInput);
+
+    // records is a public list so always clear it
+    records.clear();
+
+    PbbDecoder decoder;
+    qint64 size = sourceSize(pbbFile);
+
+    startProgress(tr("Importing contacts"), size);
+
+    decodePbb(pbbFile, decoder, [&](const QStringList &record, qint64 position) {
+        // fields are classified later by sanitizeRecords
+        records.addRecord(record);
+        valueCount += record.count();
+        reportProgress(position);
+        return !canceled.load();
+    });
+
+    totalRecords = decoder.totalRecords();
+
+    finishProgress(size);
+
+    // if there are more than 255 records the totalRecords value may be
+    // incorrect. always use records.count() for the total and alert
+    // user via console if totals do not match. mismatch is unlikely
+    // since there is a limit on how many contacts you can store on a
+    // sim card.
+    if (totalRecords != records.count()) {
+        qDebug() << "Records total in pbb file does not match number of records detected!";
+        qDebug() << "Total:" << totalRecords << " Detected:" << records.count();
+    }
+
+    stage.count("bytes", size);
+    stage.count("records", records.count());
+    stage.count("declaredRecords", totalRecords);
+    stage.count("values", valueCount);
+    report.add(stage);
+}
+
+// hands every record of a pbb file to handle along with the position in
+// the file, until handle returns false. a plain file is mapped and
+// decoded in one go. anything else, e.g. a compressed file, is decoded
+// in chunks of inputChunkSize.
+void ContactConverter::decodePbb(QIODevice *device, PbbDecoder &decoder,
+                                 const std::function<bool(const QStringList &, qint64)> &handle)
+{
+    QStringList record;
+    QFile *file = qobject_cast<QFile *>(device);
+    qint64 size = device->size();
+    uchar *mapped = (file && size > 0) ? file->map(0, size) : 0;
+
+    if (mapped) {
+        decoder.setData(reinterpret_cast<const char *>(mapped), size);
+        while (decoder.readRecord(record) && handle(record, decoder.position())) {}
+        file->unmap(mapped);
+        return;
+    }
+
+    QByteArray chunk;
+    bool isFinal = false;
+    bool isOpen = true;
+    while (isOpen && !isFinal) {
+        chunk = device->read(inputChunkSize);
+        isFinal = chunk.size() < inputChunkSize;
+        decoder.setData(chunk.constData(), chunk.size(), isFinal);
+        while (isOpen && decoder.readRecord(record)) isOpen = handle(record, sourcePosition(device));
+    }
+}
+
+// the position in the file behind device, which is ahead of the data
+// read so far if it is compressed
+qint64 ContactConverter::sourcePosition(QIODevice *device)
+{
+    CompressedDevice *inflater = qobject_cast<CompressedDevice *>(device);
+    return inflater ? inflater->source()->pos() : device->pos();
+}
+
+qint64 ContactConverter::sourceSize(QIODevice *device)
+{
+    CompressedDevice *inflater = qobject_cast<CompressedDevice *>(device);
+    return inflater ? inflater->source()->size() : device->size();
+}
+
+// every record is sanitized on its own so the records are split into
+// chunks of sanitizeChunkSize that are handed to the worker threads.
+// the result is the same as sanitizing them one after another.
+void ContactConverter::sanitizeRecords()
+{
+    StageReport::Stage stage("sanitizeRecords", currentInput);
+    int recordCount = records.count();
+    int chunkCount = (recordCount + sanitizeChunkSize - 1) / sanitizeChunkSize;
+    qint64 fieldCount = 0;
+    qint64 removedFields = 0;
+    qint64 classifierCalls = 0;
+    QAtomicInt nextChunk(0);
+    QAtomicInt doneChunks(0);
+    QMutex mutex;
+
+    startProgress(tr("Sanitizing contacts"), recordCount);
+
+    // the workers only change the fields of their own records in place.
+    // the arrays must not be shared or the first write would copy them.
+    records.detach();
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(qMax(1, qMin(maxThreads(), chunkCount)));
+    for (int t=0; t<pool.maxThreadCount(); t++) {
+        QtConcurrent::run(&pool, [&]() {
+            qint64 chunkFields = 0;
+            qint64 chunkRemoved = 0;
+            qint64 chunkCalls = 0;
+            int chunk;
+            int fields;
+
+            while (!canceled.load() && (chunk = nextChunk.fetchAndAddRelaxed(1)) < chunkCount) {
+                int last = qMin((chunk + 1) * sanitizeChunkSize, recordCount);
+                for (int i=chunk * sanitizeChunkSize; i<last; i++) {
+                    fields = records.fieldCount(i);
+                    chunkCalls += sanitizeRecord(records, i);
+                    chunkFields += fields;
+                    chunkRemoved += fields - records.fieldCount(i);
+                }
+                doneChunks.ref();
+            }
+
+            QMutexLocker locker(&mutex);
+            fieldCount += chunkFields;
+            removedFields += chunkRemoved;
+            classifierCalls += chunkCalls;
+        });
+    }
+
+    // a cancel request stops the workers after their current chunk
+    while (!pool.waitForDone(progressInterval)) {
+        reportProgress(qMin(doneChunks.load() * sanitizeChunkSize, recordCount));
+    }
+
+    finishProgress(recordCount);
+
+    stage.count("records", records.count());
+    stage.count("fields", fieldCount);
+    stage.count("removedFields", removedFields);
+    stage.count("classifierCalls", classifierCalls);
+    report.add(stage);
+}
+
+// returns the number of values that went through the classifier
+int ContactConverter::sanitizeRecord(ContactStore &store, int record)
+{
+    static const ContactStore::FieldParam telTypes[] = {
+        ContactStore::Cell, ContactStore::Home, ContactStore::Work, ContactStore::Other
+    };
+    static const ContactStore::FieldParam emailTypes[] = {
+        ContactStore::Home, ContactStore::Work, ContactStore::Other
+    };
+    const int telTypesCount = 4;
+    const int emailTypesCount = 3;
+
+    int telTotal = 0;
+    int emailTotal = 0;
+    int classified = 0;
+    int start,length;
+    ContactStore::FieldKind kind;
+
+    for (int j=0; j<store.fieldCount(record); j++) {
+        ContactStore::Field &f = store.field(record, j);
+
+        // strip invalid characters and trim the edges in place. the
+        // field is then narrowed to the part of the pool that is left.
+        length = FieldClassifier::sanitize(store.valueData(f), f.length, &start);
+        if (length == 0) {
+            store.removeField(record, j);
+            j--; // back up if field was removed to avoid skipping any
+            continue;
+        }
+        f.offset += start;
+        f.length = length;
+        f.param = ContactStore::NoParam;
+
+        if (j == 0) { // first entry is always name
+            f.kind = ContactStore::FirstName;
+            continue;
+        }
+
+        // second entry might also be name
+        kind = FieldClassifier::classify(store.valueData(f), f.length, j == 1);
+        classified++;
+        f.kind = kind;
+        if (kind == ContactStore::Tel) {
+            f.param = telTypes[telTotal];
+            if (telTotal < telTypesCount - 1) telTotal++;
+        } else if (kind == ContactStore::Email) {
+            f.param = emailTypes[emailTotal];
+            if (emailTotal < emailTypesCount - 1) emailTotal++;
+        }
+    }
+    return classified;
+}
+
+// maps a snapshot written by saveSnapshot(). the records stay on disk
+// until they are used.
+bool ContactConverter::loadSnapshot(const QString &path)
+{
+    StageReport::Stage stage("loadSnapshot", path);
+
+    startProgress(tr("Loading snapshot"), 0);
+    bool ok = ContactSnapshot::load(path, &records);
+    finishProgress(0);
+
+    stage.count("bytes", QFileInfo(path).size());
+    stage.count("records", records.count());
+    report.add(stage);
+    return ok;
+}
+
+// writes the records to a snapshot which loads without parsing
+bool ContactConverter::saveSnapshot(const QString &path)
+{
+    StageReport::Stage stage("saveSnapshot", currentInput);
+
+    startProgress(tr("Saving snapshot"), 0);
+    bool ok = ContactSnapshot::save(records, path);
+    finishProgress(0);
+
+    stage.count("records", records.count());
+    stage.count("bytesWritten", QFileInfo(path).size());
+    report.add(stage);
+    return ok;
+}
+
+// merges records that share a phone number or email address under the
+// same name. returns the number of records that were collapsed.
+int ContactConverter::deduplicateRecords()
+{
+    if (canceled.load() || records.isEmpty()) return 0;
+
+    StageReport::Stage stage("deduplicateRecords", currentInput);
+    stage.count("records", records.count());
+
+    startProgress(tr("Merging duplicates..."), 0);
+    ContactDeduper deduper;
+    int collapsed = deduper.deduplicate(records);
+    mergedDuplicates += collapsed;
+    if (collapsed > 0) index.clear();
+    finishProgress(0);
+
+    stage.count("collapsed", collapsed);
+    report.add(stage);
+    return collapsed;
+}
+
+// sorts the keys collected during the import and indexes the records
+// that weren't seen yet
+void ContactConverter::buildIndex()
+{
+    StageReport::Stage stage("buildIndex", currentInput);
+    stage.count("indexedRecords", records.count() - index.count());
+
+    index.add(records);
+    index.build();
+
+    stage.count("records", records.count());
+    report.add(stage);
+}
+
+// returns the records that were changed so views only have to update
+// those. records without both names are left alone.
+QVector<int> ContactConverter::reverseNames()
+{
+    QVector<int> changed;
+    for (int i=0; i<records.count(); i++) {
+        if (reverseRecord(records, i)) changed.append(i);
+    }
+    return changed;
+}
+
+bool ContactConverter::reverseRecord(ContactStore &store, int record)
+{
+    int fnIndex = -1;
+    int lnIndex = -1;
+    for (int j=0; j<store.fieldCount(record); j++) {
+        if (store.field(record, j).kind == ContactStore::FirstName) {
+            fnIndex = j;
+        } else if (store.field(record, j).kind == ContactStore::LastName) {
+            lnIndex = j;
+        }
+    }
+    // the fields keep their kind and position, only the values they
+    // point to in the pool are exchanged
+    if (fnIndex < 0 || lnIndex < 0) return false;
+    store.swapValues(store.field(record, fnIndex), store.field(record, lnIndex));
+    return true;
+}
+
+bool ContactConverter::generateVCF(QIODevice *device)
+{
+    VcfWriter writer(device);
+    StageReport::Stage stage("generateVCF", currentInput);
+
+    startProgress(tr("Generating VCF"), records.count());
+
+    for (int i=0; i<records.count(); i++) {
+        reportProgress(i);
+        if (canceled.load() || writer.hasError()) break;
+
+        writer.writeRecord(records, i);
+    }
+    writer.flush();
+
+    finishProgress(records.count());
+
+    stage.count("records", records.count());
+    stage.count("bytesWritten", writer.bytesWritten());
+    report.add(stage);
+    return !writer.hasError();
+}
+
+// writes the records into several vcf files, e.g. for importers that
+// reject large files. a shard ends before it would hold more than
+// maxCards cards or maxBytes bytes, 0 means no limit. the cards are
+// encoded in chunks on all threads and the chunks are written in order
+// as soon as they are done. the optional manifest lists every shard.
+// if path ends in .gz or .zst every shard is compressed, maxBytes then
+// limits the size before compression.
+bool ContactConverter::generateShards(const QString &path, int maxCards, qint64 maxBytes, bool writeManifest)
+{
+    StageReport::Stage stage("generateShards", currentInput);
+    int recordCount = records.count();
+    int chunkCount = (recordCount + shardChunkSize - 1) / shardChunkSize;
+    int nextChunk = 0;
+    int record = 0;
+    bool ok = true;
+
+    QFile shardFile;
+    CompressedDevice::Format format = CompressedDevice::formatForPath(path);
+    QScopedPointer<CompressedDevice> deflater;
+    QIODevice *shardDevice = &shardFile;
+    int shardCards = 0;
+    qint64 shardBytes = 0;
+    qint64 totalBytes = 0;
+    QJsonArray manifest;
+
+    // records up to the end of the shard at hand are written at once
+    int pendingFirst = 0;
+    int pendingFrom = 0;
+    auto closeShard = [&]() {
+        if (!shardFile.isOpen()) return;
+        if (deflater) {
+            ok = deflater->finish() && ok;
+            deflater.reset();
+        }
+        shardFile.close();
+        qint64 fileBytes = QFileInfo(shardFile.fileName()).size();
+        QJsonObject entry;
+        entry.insert("file", QFileInfo(shardFile.fileName()).fileName());
+        entry.insert("firstRecord", pendingFirst);
+        entry.insert("cards", shardCards);
+        entry.insert("bytes", double(fileBytes));
+        manifest.append(entry);
+        totalBytes += fileBytes;
+    };
+
+    shards.clear();
+    lastError.clear();
+
+    if (!CompressedDevice::isSupported(format)) {
+        lastError = tr("The compression format is not supported.");
+        return false;
+    }
+
+    // only a few chunks are encoded ahead of the writer so memory stays
+    // close to a few chunks no matter how many records there are
+    QThreadPool pool;
+    pool.setMaxThreadCount(maxThreads());
+    QQueue<QFuture<EncodedChunk> > running;
+
+    startProgress(tr("Generating VCF"), recordCount);
+
+    while (ok && (nextChunk < chunkCount || !running.isEmpty())) {
+        while (nextChunk < chunkCount && running.count() < pool.maxThreadCount() * 2) {
+            int first = nextChunk * shardChunkSize;
+            int last = qMin(first + shardChunkSize, recordCount);
+            running.enqueue(QtConcurrent::run(&pool, [this, first, last]() {
+                return encodeChunk(first, last);
+            }));
+            nextChunk++;
+        }
+
+        EncodedChunk chunk = running.dequeue().result();
+        if (canceled.load()) break;
+
+        pendingFrom = 0;
+        for (int i=0; i<chunk.ends.count() && ok; i++, record++) {
+            int start = i > 0 ? chunk.ends.at(i - 1) : 0;
+            int cardSize = chunk.ends.at(i) - start;
+
+            // a shard always takes at least one card
+            bool isFull = shardFile.isOpen() &&
+                          ((maxCards > 0 && shardCards >= maxCards) ||
+                           (maxBytes > 0 && shardBytes + cardSize > maxBytes));
+            if (!shardFile.isOpen() || isFull) {
+                if (shardFile.isOpen()) {
+                    ok = shardDevice->write(chunk.data.constData() + pendingFrom, start - pendingFrom) == start - pendingFrom;
+                    closeShard();
+                }
+                shardFile.setFileName(shardPath(path, shards.count() + 1));
+                if (!ok || !shardFile.open(QIODevice::WriteOnly)) {
+                    ok = false;
+                    break;
+                }
+                shardDevice = &shardFile;
+                if (format != CompressedDevice::Plain) {
+                    deflater.reset(new CompressedDevice(&shardFile, format));
+                    ok = deflater->open(QIODevice::WriteOnly);
+                    shardDevice = deflater.data();
+                }
+                shards.append(shardFile.fileName());
+                pendingFirst = record;
+                pendingFrom = start;
+                shardCards = 0;
+                shardBytes = 0;
+            }
+            shardCards++;
+            shardBytes += cardSize;
+        }
+
+        // the rest of the chunk belongs to the open shard
+        if (ok && shardFile.isOpen()) {
+            int length = chunk.data.size() - pendingFrom;
+            ok = shardDevice->write(chunk.data.constData() + pendingFrom, length) == length;
+        }
+        reportProgress(record);
+    }
+
+    // the workers must not outlive the records they read
+    for (int i=0; i<running.count(); i++) running[i].waitForFinished();
+    closeShard();
+
+    if (ok && writeManifest && !canceled.load()) {
+        QJsonObject root;
+        root.insert("source", currentInput);
+        root.insert("records", recordCount);
+        root.insert("shards", manifest);
+        QSaveFile manifestFile(shardPath(path, 0));
+        ok = manifestFile.open(QIODevice::WriteOnly) &&
+             manifestFile.write(QJsonDocument(root).toJson()) >= 0 &&
+             manifestFile.commit();
+    }
+
+    finishProgress(recordCount);
+
+    stage.count("records", recordCount);
+    stage.count("shards", shards.count());
+    stage.count("bytesWritten", totalBytes);
+    report.add(stage);
+
+    if (!ok) lastError = tr("The output cannot be written.");
+    return ok;
+}
+
+// the files written by the last call to generateShards()
+QStringList ContactConverter::shardFiles() const
+{
+    return shards;
+}
+
+// contacts.vcf becomes contacts-0001.vcf, contacts-0002.vcf and so on.
+// shard 0 is the manifest, contacts.manifest.json. contacts.vcf.gz
+// becomes contacts-0001.vcf.gz.
+QString ContactConverter::shardPath(const QString &path, int shard)
+{
+    QString plainPath = CompressedDevice::strippedPath(path);
+    QString compression = path.mid(plainPath.length());
+    QFileInfo fi(plainPath);
+    QString baseName = fi.suffix().compare("vcf", Qt::CaseInsensitive) == 0 ? fi.completeBaseName() : fi.fileName();
+    if (shard == 0) return fi.dir().filePath(baseName + ".manifest.json");
+    return fi.dir().filePath(baseName + QString("-%1.vcf").arg(shard, 4, 10, QLatin1Char('0')) + compression);
+}
+
+// formats records first to last - 1 into memory. a chunk size of 0
+// makes the writer hand over every card on its own so its end is known.
+ContactConverter::EncodedChunk ContactConverter::encodeChunk(int first, int last) const
+{
+    EncodedChunk chunk;
+    if (canceled.load()) return chunk;
+
+    QBuffer buffer(&chunk.data);
+    buffer.open(QIODevice::WriteOnly);
+    VcfWriter writer(&buffer, 0);
+    chunk.ends.reserve(last - first);
+    for (int i=first; i<last; i++) {
+        writer.writeRecord(records, i);
+        chunk.ends.append(int(buffer.pos()));
+    }
+    writer.flush();
+    buffer.close();
+    return chunk;
+}
+
+// converts path straight to device without collecting the records. the
+// input is read in batches which are sanitized, reversed and written on
+// their own threads and released once written. the stages are joined by
+// bounded queues so memory stays the same whatever the size of the
+// input. duplicates can't be merged this way.
+bool ContactConverter::convertFile(const QString &path, QIODevice *device, bool reverse)
+{
+    records.clear();
+    lastError.clear();
+    mergedDuplicates = 0;
+    streamedRecords = 0;
+    currentInput = path;
+
+    QFile contactsFile(path);
+    QFileInfo fi(contactsFile);
+    CompressedDevice::Format format = fi.isDir() ? CompressedDevice::Plain : CompressedDevice::formatForPath(path);
+
+    if (!contactsFile.exists()) {
+        lastError = tr("The input source cannot be found.");
+        return false;
+    }
+
+    // the files of a folder are sniffed one by one while they are read
+    FormatSniffer::Format type = fi.isDir() ? FormatSniffer::Unknown : FormatSniffer::formatForFile(path);
+
+    // a snapshot is mapped rather than read so it is written from the
+    // records directly
+    if (type == FormatSniffer::Snapshot) {
+        if (!importFile(path)) return false;
+        if (reverse) reverseNames();
+        streamedRecords = records.count();
+        if (!generateVCF(device)) {
+            lastError = tr("The output cannot be written.");
+            return false;
+        }
+        return true;
+    }
+
+    if (!fi.isDir() && type != FormatSniffer::Monosim && type != FormatSniffer::Pbb && type != FormatSniffer::Vcf) {
+        lastError = tr("The input source is not a supported format.");
+        return false;
+    }
+
+    if (!CompressedDevice::isSupported(format)) {
+        lastError = tr("The compression format is not supported.");
+        return false;
+    }
+
+    if (!fi.isDir() && !contactsFile.open(QIODevice::ReadOnly)) {
+        lastError = tr("The input source cannot be opened.");
+        return false;
+    }
+
+    CompressedDevice inflater(&contactsFile, format);
+    QIODevice *source = &contactsFile;
+    if (format != CompressedDevice::Plain) {
+        if (!inflater.open(QIODevice::ReadOnly)) {
+            lastError = tr("The input source cannot be opened.");
+            return false;
+        }
+        source = &inflater;
+    }
+
+    BatchQueue parsed(queueDepth, &canceled);
+    BatchQueue prepared(queueDepth, &canceled);
+    QAtomicInt progress; // per mille of the input
+    bool sanitize = type == FormatSniffer::Pbb;
+    StageReport::Stage stage("convertFile", path);
+
+    // a pool of its own so the stages never wait for a free thread
+    QThreadPool pool;
+    pool.setMaxThreadCount(2);
+
+    startProgress(tr("Converting contacts"), 1000);
+
+    QFuture<void> input = QtConcurrent::run(&pool, [&]() {
+        streamInput(path, type, source, &parsed, &progress);
+    });
+    QFuture<void> prepare = QtConcurrent::run(&pool, [&]() {
+        streamPrepare(&parsed, &prepared, sanitize, reverse);
+    });
+
+    VcfWriter writer(device);
+    ContactStore *batch;
+    while (prepared.pop(batch)) {
+        for (int i=0; i<batch->count(); i++) writer.writeRecord(*batch, i);
+        streamedRecords += batch->count();
+        delete batch;
+
+        reportProgress(progress.load());
+        if (writer.hasError()) break;
+    }
+    writer.flush();
+
+    // a failed write stops the other stages as well
+    parsed.abort();
+    prepared.abort();
+    input.waitForFinished();
+    prepare.waitForFinished();
+    qDeleteAll(parsed.takeAll());
+    qDeleteAll(prepared.takeAll());
+    inflater.close();
+    contactsFile.close();
+
+    finishProgress(1000);
+
+    stage.count("bytes", fi.isDir() ? 0 : fi.size());
+    stage.count("records", streamedRecords);
+    stage.count("bytesWritten", writer.bytesWritten());
+    report.add(stage);
+
+    if (writer.hasError()) {
+        lastError = tr("The output cannot be written.");
+        return false;
+    }
+    if (inflater.hasError()) {
+        lastError = inflater.errorString();
+        return false;
+    }
+    return true;
+}
+
+// the number of records the last call to convertFile() wrote
+int ContactConverter::recordsConverted() const
+{
+    return streamedRecords;
+}
+
+// first stage of convertFile(). reads the input into batches of about
+// batchSize records.
+void ContactConverter::streamInput(const QString &path, FormatSniffer::Format type, QIODevice *input, BatchQueue *out, QAtomicInt *progress)
+{
+    ContactStore *batch = new ContactStore;
+    bool isOpen = true;
+
+    // hands the batch to the next stage once it is full
+    auto flushBatch = [&](bool isFinal) {
+        if (!isOpen || batch->isEmpty() || (!isFinal && batch->count() < batchSize)) return;
+        if (out->push(batch)) {
+            batch = new ContactStore;
+        } else {
+            batch->clear();
+            isOpen = false;
+        }
+    };
+
+    if (QFileInfo(path).isDir()) {
+        QDir dir(path);
+        dir.setFilter(QDir::Files);
+        const QStringList fileList = dir.entryList();
+        const QString prefix = path + QDir::separator();
+
+        // each file is decoded whole and already sanitized by parseFile()
+        for (int i=0; i<fileList.count() && isOpen && !canceled.load(); i++) {
+            FormatSniffer::Format fileType = FormatSniffer::formatForFile(prefix + fileList.at(i));
+            if (fileType != FormatSniffer::Unknown) {
+                ContactStore store;
+                QString error;
+                if (parseFile(prefix + fileList.at(i), fileType, &store, &error)) {
+                    batch->append(store);
+                } else {
+                    emit warning(fileList.at(i) + ": " + error);
+                }
+            }
+            progress->store(int((i + 1) * 1000LL / fileList.count()));
+            flushBatch(false);
+        }
+    } else if (type == FormatSniffer::Vcf) {
+        qint64 size = qMax(sourceSize(input), qint64(1));
+
+        // a piece of text only holds complete cards
+        decodeVcf(input, [&](const char *bytes, qint64 length, TextDecoder::Encoding encoding, qint64 position) {
+            parseVcfText(bytes, length, encoding, batch);
+            progress->store(int(position * 1000 / size));
+            flushBatch(false);
+            return isOpen && !canceled.load();
+        });
+    } else if (type == FormatSniffer::Pbb) {
+        PbbDecoder decoder;
+        qint64 size = qMax(sourceSize(input), qint64(1));
+        decodePbb(input, decoder, [&](const QStringList &record, qint64 position) {
+            batch->addRecord(record);
+            progress->store(int(position * 1000 / size));
+            flushBatch(false);
+            return isOpen && !canceled.load();
+        });
+    } else {
+        qint64 size = qMax(sourceSize(input), qint64(1));
+
+        // a batch only ends after a complete record
+        decodeMonosim(input, [&](const QString &line, qint64 position) {
+            progress->store(int(position * 1000 / size));
+            if (addMonosimLine(line, batch)) flushBatch(false);
+            return isOpen && !canceled.load();
+        });
+        batch->discardRecord();
+    }
+
+    flushBatch(true);
+    delete batch;
+    out->close();
+}
+
+// second stage of convertFile()
+void ContactConverter::streamPrepare(BatchQueue *in, BatchQueue *out, bool sanitize, bool reverse)
+{
+    ContactStore *batch;
+    while (in->pop(batch)) {
+        for (int i=0; i<batch->count(); i++) {
+            if (sanitize) sanitizeRecord(*batch, i);
+            if (reverse) reverseRecord(*batch, i);
+        }
+        if (!out->push(batch)) {
+            delete batch;
+            break;
+        }
+    }
+    out->close();
+}
@@ -0,0 +1,195 @@
+/********************************************************************
+
+Name: Versatacts
+Homepage: http://github.com/ae5chylu5/versatacts
+Author: ae5chylu5
+Description: A versatile gui application capable of extracting and
+             converting contacts to/from a variety of popular
+             mobile formats.
+
+Copyright (C) 2016 ae5chylu5
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+********************************************************************/
+
+#ifndef CONTACTCONVERTER_H
+#define CONTACTCONVERTER_H
+
+#include "boundedqueue.h"
+#include "compresseddevice.h"
+#include "contactdeduper.h"
+#include "contactindex.h"
+#include "contactsnapshot.h"
+#include "contactstore.h"
+#include "fieldclassifier.h"
+#include "formatsniffer.h"
+#include "mergecache.h"
+#include "pbbdecoder.h"
+#include "stagereport.h"
+#include "textdecoder.h"
+#include "vcardreader.h"
+#include "vcfwriter.h"
+
+#include <QAtomicInt>
+#include <QBuffer>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QFuture>
+#include <QIODevice>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QObject>
+#include <QQueue>
+#include <QSaveFile>
+#include <QScopedPointer>
+#include <QStandardPaths>
+#include <QStringList>
+#include <QTextStream>
+#include <QThread>
+#include <QThreadPool>
+#include <QVector>
+#include <QWaitCondition>
+#include <QtConcurrentRun>
+
+#include <functional>
+
+// ContactConverter holds all of the parsing and vcf generation logic.
+// it only depends on qtcore so it can be shared by the gui and the
+// headless command line tool. long running stages report progress
+// through signals and can be stopped by calling cancel() from any
+// thread. a cancel holds until resetCancel() starts the next operation.
+class ContactConverter : public QObject
+{
+    Q_OBJECT
+
+public:
+    ContactConverter(QObject *parent = 0);
+    ~ContactConverter();
+    ContactStore records;
+    int totalRecords;
+
+    bool importFile(const QString &path);
+    bool importFile(const QString &path, FormatSniffer::Format type);
+    bool importFiles(const QStringList &paths);
+    QStringList fileErrors() const;
+    void importPBB(QIODevice *pbbFile);
+    void importMonosim(QIODevice *file);
+    void mergeRecords(const QString &path);
+    void sanitizeRecords();
+    bool loadSnapshot(const QString &path);
+    bool saveSnapshot(const QString &path);
+    int deduplicateRecords();
+    QVector<int> reverseNames();
+    bool generateVCF(QIODevice *device);
+    bool generateShards(const QString &path, int maxCards, qint64 maxBytes, bool writeManifest = false);
+    QStringList shardFiles() const;
+    static QString shardPath(const QString &path, int shard);
+    bool convertFile(const QString &path, QIODevice *device, bool reverse = false);
+    int recordsConverted() const;
+    StageReport *stageReport();
+    ContactIndex *searchIndex();
+    QVector<int> findRecords(const QString &text);
+    void indexRecords();
+    bool isCanceled() const;
+    void resetCancel();
+    QString errorString() const;
+    void setMaxThreads(int count);
+    int maxThreads() const;
+    void setMergeCache(bool enabled, bool verifyContents = false);
+    void setCacheDirectory(const QString &path);
+    void setDeduplicate(bool enabled);
+    void setBinaryLimit(int bytes);
+    int binaryLimit() const;
+    int duplicatesMerged() const;
+
+public slots:
+    void cancel();
+
+signals:
+    void progressStarted(const QString &label, int maximum);
+    void progressChanged(int value);
+    void progressFinished();
+    void warning(const QString &message);
+
+private:
+    enum FileState {
+        FilePending,
+        FileParsed,
+        FileFailed,
+        FileSkipped
+    };
+
+    typedef BoundedQueue<ContactStore *> BatchQueue;
+
+    // a run of records encoded by one thread and the end of every card
+    struct EncodedChunk {
+        QByteArray data;
+        QVector<int> ends;
+    };
+
+    static const int progressInterval = 20; // milliseconds
+    static const int batchSize = 256; // records handed between streaming stages
+    static const int queueDepth = 4; // batches waiting between two stages
+    static const int shardChunkSize = 2048; // records encoded by one thread at a time
+    static const int sanitizeChunkSize = 4096; // records sanitized by one thread at a time
+    static const int inputChunkSize = 1024 * 1024; // bytes inflated at a time from compressed input
+
+    bool parseFile(const QString &path, FormatSniffer::Format type, ContactStore *store, QString *error) const;
+    bool parseVcf(const QString &path, ContactStore *store) const;
+    bool parseVcfStream(QIODevice *device, ContactStore *store) const;
+    void parseVcfText(const char *bytes, qint64 size, TextDecoder::Encoding encoding, ContactStore *store) const;
+    static int lastCardStart(const QByteArray &buffer);
+    static const char *vcfText(const char *data, qint64 *size, TextDecoder::Encoding *encoding, QByteArray *transcoded);
+    static void decodeVcf(QIODevice *device, const std::function<bool(const char *, qint64, TextDecoder::Encoding, qint64)> &handle);
+    static void decodePbb(QIODevice *device, PbbDecoder &decoder, const std::function<bool(const QStringList &, qint64)> &handle);
+    static void decodeMonosim(QIODevice *device, const std::function<bool(const QString &, qint64)> &handle);
+    static qint64 sourcePosition(QIODevice *device);
+    static qint64 sourceSize(QIODevice *device);
+    static bool isBinary(const VcardReader::Property &property);
+    static bool addMonosimLine(QString line, ContactStore *store);
+    static int sanitizeRecord(ContactStore &store, int record);
+    static bool reverseRecord(ContactStore &store, int record);
+    void streamInput(const QString &path, FormatSniffer::Format type, QIODevice *input, BatchQueue *out, QAtomicInt *progress);
+    void streamPrepare(BatchQueue *in, BatchQueue *out, bool sanitize, bool reverse);
+    EncodedChunk encodeChunk(int first, int last) const;
+    void startProgress(const QString &label, int maximum);
+    void reportProgress(int value);
+    void finishProgress(int maximum);
+    void buildIndex();
+    QAtomicInt canceled;
+    QString lastError;
+    QStringList failedFiles;
+    int threadLimit;
+    bool cacheEnabled;
+    bool cacheHashEnabled;
+    QString cacheDir;
+    bool dedupEnabled;
+    int maxBinarySize;
+    int mergedDuplicates;
+    int streamedRecords;
+    QString currentInput;
+    QStringList shards;
+    StageReport report;
+    ContactIndex index;
+    QElapsedTimer progressTimer;
+};
+
+#endif // CONTACTCONVERTER_H
@@ -0,0 +1,282 @@
+/********************************************************************
+
+Name: Versatacts
+Homepage: http://github.com/ae5chylu5/versatacts
+Author: ae5chylu5
+Description: A versatile gui application capable of extracting and
+             converting contacts to/from a variety of popular
+             mobile formats.
+
+Copyright (C) 2016 ae5chylu5
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+********************************************************************/
+
+#include "contactdeduper.h"
+
+ContactDeduper::ContactDeduper()
+{
+
+}
+
+// returns how many records were merged into others
+int ContactDeduper::deduplicate(ContactStore &store)
+{
+    int recordCount = store.count();
+    QMultiHash<quint64, int> owners; // first record that produced each key
+    QStringRef value;
+    QString name,key;
+    QChar prefix;
+    quint64 hash;
+    bool isJoined;
+
+    parents.resize(recordCount);
+    for (int i=0; i<recordCount; i++) parents[i] = i;
+
+    for (int i=0; i<recordCount; i++) {
+        name = normalizedName(store, i);
+
+        for (int j=0; j<store.fieldCount(i); j++) {
+            key = recordKey(store, store.field(i, j), &prefix);
+            if (key.isEmpty()) continue;
+            hash = hashKey(prefix, name, key);
+
+            // the owners of an equal hash only count if their key is
+            // equal as well
+            isJoined = false;
+            QMultiHash<quint64, int>::const_iterator it = owners.constFind(hash);
+            for (; it != owners.constEnd() && it.key() == hash; ++it) {
+                if (!hasKey(store, it.value(), prefix, name, key)) continue;
+                unite(i, it.value());
+                isJoined = true;
+                break;
+            }
+            if (!isJoined) owners.insert(hash, i);
+        }
+    }
+    owners.clear();
+
+    // chain the members of every group together. the root of a group is
+    // always its lowest record so groups keep the order of first sight.
+    QVector<int> heads(recordCount, -1);
+    QVector<int> tails(recordCount, -1);
+    QVector<int> nexts(recordCount, -1);
+    int root;
+    for (int i=0; i<recordCount; i++) {
+        root = find(i);
+        if (heads[root] < 0) {
+            heads[root] = i;
+        } else {
+            nexts[tails[root]] = i;
+        }
+        tails[root] = i;
+    }
+
+    // the store is compacted in place. the values stay where they are in
+    // the pools, only groups of several records get new field entries
+    // which point at the values they already had.
+    QVector<bool> absorbed(recordCount, false);
+    QSet<QByteArray> seen;
+    int groups = 0;
+    for (int i=0; i<recordCount; i++) {
+        if (heads[i] < 0) continue;
+
+        // a record on its own is left as it is
+        groups++;
+        if (nexts[i] < 0) continue;
+        seen.clear();
+
+        for (int m=i; m>=0; m=nexts[m]) {
+            if (m != i) absorbed[m] = true;
+            for (int j=0; j<store.fieldCount(m); j++) {
+                ContactStore::Field f = store.field(m, j);
+
+                // the names of the first record are kept
+                if (fieldRole(store, f, &value) == NameRole && m != i) continue;
+                if (!isRepeated(store, f, &seen)) store.copyField(f);
+            }
+        }
+        store.replaceRecord(i);
+    }
+
+    parents.clear();
+    store.removeRecords(absorbed);
+    return recordCount - groups;
+}
+
+// the normalized phone number or email address of a field that records
+// are grouped by, with prefix telling the two apart. empty for any other
+// field.
+QString ContactDeduper::recordKey(const ContactStore &store, const ContactStore::Field &f, QChar *prefix)
+{
+    QStringRef value;
+    FieldRole role = fieldRole(store, f, &value);
+    if (role == PhoneRole) {
+        *prefix = QLatin1Char('t');
+        return normalizedPhone(value);
+    }
+    if (role == EmailRole) {
+        *prefix = QLatin1Char('e');
+        return value.trimmed().toString().toLower();
+    }
+    return QString();
+}
+
+// true if record has the name and the key. only asked when the hash of
+// the key matches.
+bool ContactDeduper::hasKey(const ContactStore &store, int record, QChar prefix, const QString &name, const QString &key)
+{
+    QChar fieldPrefix;
+    if (normalizedName(store, record) != name) return false;
+    for (int j=0; j<store.fieldCount(record); j++) {
+        if (recordKey(store, store.field(record, j), &fieldPrefix) == key && fieldPrefix == prefix) return true;
+    }
+    return false;
+}
+
+// true if a field with the same phone number, email address or line was
+// seen before in the same group. names are never repeated. the lines are
+// compared in full so only equal ones count.
+bool ContactDeduper::isRepeated(const ContactStore &store, const ContactStore::Field &f, QSet<QByteArray> *seen)
+{
+    QStringRef value;
+    QString key;
+    QByteArray line;
+
+    FieldRole role = fieldRole(store, f, &value);
+    if (role == NameRole) return false;
+
+    if (role == PhoneRole && !(key = normalizedPhone(value)).isEmpty()) {
+        line = 't' + key.toUtf8();
+    } else if (role == EmailRole) {
+        line = 'e' + value.trimmed().toString().toLower().toUtf8();
+    } else if (f.kind == ContactStore::Binary) {
+        line = 'b' + store.binary(f);
+    } else {
+        line = char('a' + f.kind) + store.value(f).toUtf8();
+    }
+
+    if (seen->contains(line)) return true;
+    seen->insert(line);
+    return false;
+}
+
+// tells the phone numbers and email addresses apart from the other
+// fields. for raw vcf lines value is narrowed to the part after the
+// property name.
+ContactDeduper::FieldRole ContactDeduper::fieldRole(const ContactStore &store, const ContactStore::Field &f, QStringRef *value)
+{
+    *value = store.value(f);
+
+    switch (f.kind) {
+    case ContactStore::FirstName:
+    case ContactStore::LastName:
+        return NameRole;
+    case ContactStore::Tel:
+        return PhoneRole;
+    case ContactStore::Email:
+        return EmailRole;
+    case ContactStore::Raw: {
+        int colon = value->indexOf(QLatin1Char(':'));
+        if (colon < 0) return OtherRole;
+
+        // parameters follow the property name after a semicolon
+        QStringRef property = value->left(colon);
+        int semicolon = property.indexOf(QLatin1Char(';'));
+        if (semicolon >= 0) property = property.left(semicolon);
+
+        if (property.compare(QLatin1String("TEL"), Qt::CaseInsensitive) == 0) {
+            *value = value->mid(colon + 1);
+            return PhoneRole;
+        }
+        if (property.compare(QLatin1String("EMAIL"), Qt::CaseInsensitive) == 0) {
+            *value = value->mid(colon + 1);
+            return EmailRole;
+        }
+        return OtherRole;
+    }
+    default:
+        return OtherRole;
+    }
+}
+
+// reduces a phone number to the digits detectPhone accepts. spaces,
+// dashes, dots and brackets are dropped. returns an empty string if it
+// isn't a phone number.
+QString ContactDeduper::normalizedPhone(const QStringRef &value)
+{
+    QString digits;
+    digits.reserve(value.length());
+    for (int i=0; i<value.length(); i++) {
+        QChar c = value.at(i);
+        if (c.isDigit()) {
+            digits.append(c);
+        } else if (c == QLatin1Char('+') || c == QLatin1Char('#')) {
+            if (!digits.isEmpty()) return QString();
+        } else if (c != QLatin1Char(' ') && c != QLatin1Char('-') && c != QLatin1Char('.') &&
+                   c != QLatin1Char('(') && c != QLatin1Char(')')) {
+            return QString();
+        }
+    }
+    return FieldClassifier::isPhone(digits) ? digits : QString();
+}
+
+QString ContactDeduper::normalizedName(const ContactStore &store, int record)
+{
+    QString name;
+    for (int j=0; j<store.fieldCount(record); j++) {
+        const ContactStore::Field &f = store.field(record, j);
+        if (f.kind != ContactStore::FirstName && f.kind != ContactStore::LastName) continue;
+        if (!name.isEmpty()) name.append(QLatin1Char(' '));
+        name.append(store.value(f));
+    }
+    return name.simplified().toLower();
+}
+
+// 64 bit fnv-1a over the key parts. with 32 bit hashes a few million
+// keys would already collide.
+quint64 ContactDeduper::hashKey(QChar prefix, const QString &name, const QString &value)
+{
+    quint64 hash = Q_UINT64_C(14695981039346656037);
+    const quint64 prime = Q_UINT64_C(1099511628211);
+
+    hash = (hash ^ prefix.unicode()) * prime;
+    for (int i=0; i<name.length(); i++) hash = (hash ^ name.at(i).unicode()) * prime;
+    hash = (hash ^ 0xffff) * prime;
+    for (int i=0; i<value.length(); i++) hash = (hash ^ value.at(i).unicode()) * prime;
+    return hash;
+}
+
+int ContactDeduper::find(int record)
+{
+    while (parents[record] != record) {
+        parents[record] = parents[parents[record]];
+        record = parents[record];
+    }
+    return record;
+}
+
+// the lower record becomes the root so groups are emitted in order
+void ContactDeduper::unite(int a, int b)
+{
+    a = find(a);
+    b = find(b);
+    if (a == b) return;
+    if (a < b) {
+        parents[b] = a;
+    } else {
+        parents[a] = b;
+    }
+}
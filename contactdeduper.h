@@ -0,0 +1,77 @@
+/********************************************************************
+
+Name: Versatacts
+Homepage: http://github.com/ae5chylu5/versatacts
+Author: ae5chylu5
+Description: A versatile gui application capable of extracting and
+             converting contacts to/from a variety of popular
+             mobile formats.
+
+Copyright (C) 2016 ae5chylu5
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+********************************************************************/
+
+#ifndef CONTACTDEDUPER_H
+#define CONTACTDEDUPER_H
+
+#include "contactstore.h"
+#include "fieldclassifier.h"
+
+#include <QByteArray>
+#include <QHash>
+#include <QSet>
+#include <QString>
+#include <QVector>
+
+// ContactDeduper collapses records that describe the same person. every
+// record is reduced to a few 64 bit keys:
+//   name + phone digits    for each phone number
+//   name + email           for each email address
+// a name alone doesn't tell two people apart so records without a phone
+// number or email address are never merged. records sharing a key are
+// grouped with a union find in a single pass so the cost grows linearly
+// with the number of records. keys with the same hash are compared in
+// full before two records are joined. the fields of a group are merged
+// into its first record in place without repeating a phone number, email
+// or any other identical line. records without a duplicate are left as
+// they are.
+class ContactDeduper
+{
+public:
+    ContactDeduper();
+    int deduplicate(ContactStore &store);
+
+private:
+    enum FieldRole {
+        NameRole,
+        PhoneRole,
+        EmailRole,
+        OtherRole
+    };
+
+    static FieldRole fieldRole(const ContactStore &store, const ContactStore::Field &f, QStringRef *value);
+    static QString recordKey(const ContactStore &store, const ContactStore::Field &f, QChar *prefix);
+    static bool hasKey(const ContactStore &store, int record, QChar prefix, const QString &name, const QString &key);
+    static bool isRepeated(const ContactStore &store, const ContactStore::Field &f, QSet<QByteArray> *seen);
+    static QString normalizedPhone(const QStringRef &value);
+    static QString normalizedName(const ContactStore &store, int record);
+    static quint64 hashKey(QChar prefix, const QString &name, const QString &value);
+    int find(int record);
+    void unite(int a, int b);
+    QVector<int> parents;
+};
+
+#endif // CONTACTDEDUPER_H
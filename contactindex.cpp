@@ -0,0 +1,238 @@
+/********************************************************************
+
+Name: Versatacts
+Homepage: http://github.com/ae5chylu5/versatacts
+Author: ae5chylu5
+Description: A versatile gui application capable of extracting and
+             converting contacts to/from a variety of popular
+             mobile formats.
+
+Copyright (C) 2016 ae5chylu5
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+********************************************************************/
+
+#include "contactindex.h"
+
+ContactIndex::ContactIndex()
+    : indexedCount(0)
+{
+    names.sortedCount = 0;
+    phones.sortedCount = 0;
+}
+
+void ContactIndex::clear()
+{
+    names.clear();
+    phones.clear();
+    indexedCount = 0;
+}
+
+// collects the keys of the records added to store since the last call.
+// they can't be found before build() is called.
+void ContactIndex::add(const ContactStore &store)
+{
+    // a store that shrank was replaced, e.g. by the deduper
+    if (store.count() < indexedCount) clear();
+
+    for (int i=indexedCount; i<store.count(); i++) addRecord(store, i);
+    indexedCount = store.count();
+}
+
+void ContactIndex::build()
+{
+    names.sort();
+    phones.sort();
+}
+
+// call after a single record was edited. the text of its old keys stays
+// in the pool until the index is cleared.
+void ContactIndex::updateRecord(const ContactStore &store, int record)
+{
+    if (record < 0 || record >= indexedCount) return;
+
+    names.remove(record);
+    phones.remove(record);
+    addRecord(store, record);
+    build();
+}
+
+// the number of records seen by add()
+int ContactIndex::count() const
+{
+    return indexedCount;
+}
+
+// returns the matching records in ascending order. phone numbers match
+// by their last digits, names by the beginning of any of their words.
+// with several words every one of them has to match.
+QVector<int> ContactIndex::find(const QString &text) const
+{
+    QVector<int> matches;
+    if (isPhoneQuery(text)) {
+        phones.find(phoneKey(QStringRef(&text)), &matches);
+        return matches;
+    }
+
+    const QStringList words = text.toLower().split(' ', QString::SkipEmptyParts);
+    QVector<int> wordMatches;
+    QVector<int> common;
+    for (int i=0; i<words.count(); i++) {
+        if (i == 0) {
+            names.find(words.at(i), &matches);
+            continue;
+        }
+
+        wordMatches.resize(0);
+        names.find(words.at(i), &wordMatches);
+        common.resize(0);
+        std::set_intersection(matches.constBegin(), matches.constEnd(),
+                              wordMatches.constBegin(), wordMatches.constEnd(),
+                              std::back_inserter(common));
+        matches.swap(common);
+        if (matches.isEmpty()) break;
+    }
+    return matches;
+}
+
+// digits mixed with the separators people type in phone numbers
+bool ContactIndex::isPhoneQuery(const QString &text)
+{
+    bool hasDigit = false;
+    for (int i=0; i<text.length(); i++) {
+        QChar c = text.at(i);
+        if (c.isDigit()) {
+            hasDigit = true;
+        } else if (c != QLatin1Char(' ') && c != QLatin1Char('-') && c != QLatin1Char('.') &&
+                   c != QLatin1Char('(') && c != QLatin1Char(')') && c != QLatin1Char('+')) {
+            return false;
+        }
+    }
+    return hasDigit;
+}
+
+// the digits of a phone number, last one first
+QString ContactIndex::phoneKey(const QStringRef &value)
+{
+    QString key;
+    key.reserve(value.length());
+    for (int i=value.length()-1; i>=0; i--) {
+        if (value.at(i).isDigit()) key.append(value.at(i));
+    }
+    return key;
+}
+
+void ContactIndex::addRecord(const ContactStore &store, int record)
+{
+    QStringList words;
+    QStringRef value;
+    int colon,semicolon;
+
+    for (int j=0; j<store.fieldCount(record); j++) {
+        const ContactStore::Field &f = store.field(record, j);
+        value = store.value(f);
+
+        if (f.kind == ContactStore::FirstName || f.kind == ContactStore::LastName) {
+            words = value.toString().toLower().split(' ', QString::SkipEmptyParts);
+            for (int k=0; k<words.count(); k++) names.add(words.at(k), record);
+            continue;
+        }
+
+        // raw vcf lines still carry their property name
+        if (f.kind == ContactStore::Raw) {
+            colon = value.indexOf(QLatin1Char(':'));
+            if (colon < 0) continue;
+            QStringRef property = value.left(colon);
+            semicolon = property.indexOf(QLatin1Char(';'));
+            if (semicolon >= 0) property = property.left(semicolon);
+            if (property.compare(QLatin1String("TEL"), Qt::CaseInsensitive) != 0) continue;
+            value = value.mid(colon + 1);
+        } else if (f.kind != ContactStore::Tel) {
+            continue;
+        }
+
+        QString key = phoneKey(value);
+        if (!key.isEmpty()) phones.add(key, record);
+    }
+}
+
+void ContactIndex::KeyList::clear()
+{
+    pool.clear();
+    keys.clear();
+    sortedCount = 0;
+}
+
+void ContactIndex::KeyList::add(const QString &key, int record)
+{
+    Key k = {pool.length(), key.length(), record};
+    pool.append(key);
+    keys.append(k);
+}
+
+// the pending keys are sorted on their own and merged into the rest
+void ContactIndex::KeyList::sort()
+{
+    if (sortedCount == keys.count()) return;
+
+    KeyLess less = {&pool};
+    QVector<Key>::iterator middle = keys.begin() + sortedCount;
+    std::sort(middle, keys.end(), less);
+    std::inplace_merge(keys.begin(), middle, keys.end(), less);
+    sortedCount = keys.count();
+}
+
+void ContactIndex::KeyList::remove(int record)
+{
+    int kept = 0;
+    int sortedKept = 0;
+    for (int i=0; i<keys.count(); i++) {
+        if (keys.at(i).record == record) continue;
+        if (i < sortedCount) sortedKept++;
+        keys[kept++] = keys.at(i);
+    }
+    keys.resize(kept);
+    sortedCount = sortedKept;
+}
+
+// appends the records of all sorted keys starting with prefix, in
+// ascending order and without duplicates
+void ContactIndex::KeyList::find(const QString &prefix, QVector<int> *records) const
+{
+    if (prefix.isEmpty()) return;
+
+    KeyLess less = {&pool};
+    QVector<Key>::const_iterator end = keys.constBegin() + sortedCount;
+    QVector<Key>::const_iterator it = std::lower_bound(keys.constBegin(), end, prefix, less);
+    int first = records->count();
+    for (; it != end; ++it) {
+        if (it->length < prefix.length() || QStringRef(&pool, it->offset, prefix.length()) != prefix) break;
+        records->append(it->record);
+    }
+
+    std::sort(records->begin() + first, records->end());
+    records->erase(std::unique(records->begin() + first, records->end()), records->end());
+}
+
+bool ContactIndex::KeyLess::operator()(const Key &a, const Key &b) const
+{
+    int order = QStringRef(pool, a.offset, a.length).compare(QStringRef(pool, b.offset, b.length));
+    return order < 0 || (order == 0 && a.record < b.record);
+}
+
+bool ContactIndex::KeyLess::operator()(const Key &a, const QString &text) const
+{
+    return QStringRef(pool, a.offset, a.length).compare(text) < 0;
+}
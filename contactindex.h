@@ -0,0 +1,96 @@
+/********************************************************************
+
+Name: Versatacts
+Homepage: http://github.com/ae5chylu5/versatacts
+Author: ae5chylu5
+Description: A versatile gui application capable of extracting and
+             converting contacts to/from a variety of popular
+             mobile formats.
+
+Copyright (C) 2016 ae5chylu5
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+********************************************************************/
+
+#ifndef CONTACTINDEX_H
+#define CONTACTINDEX_H
+
+#include "contactstore.h"
+
+#include <QString>
+#include <QStringList>
+#include <QStringRef>
+#include <QVector>
+
+#include <algorithm>
+#include <iterator>
+
+// ContactIndex finds records by the beginning of a name or the end of
+// a phone number without looking at every record. every word of the
+// first and last names is kept lowercase in a sorted list, the digits
+// of every phone number are kept reversed in another. a search is a
+// binary search for the range of keys starting with the query.
+//
+// records are indexed in the order they were added to the store. add()
+// only looks at records it hasn't seen yet so it can be called while a
+// store grows. the new keys are sorted in by build().
+class ContactIndex
+{
+public:
+    ContactIndex();
+    void clear();
+    void add(const ContactStore &store);
+    void build();
+    void updateRecord(const ContactStore &store, int record);
+    int count() const;
+    QVector<int> find(const QString &text) const;
+    static bool isPhoneQuery(const QString &text);
+
+private:
+    struct Key {
+        int offset;
+        int length;
+        int record;
+    };
+
+    // keys share a single string pool like the values of ContactStore.
+    // entries before sortedCount are in order, the rest are pending.
+    struct KeyList {
+        QString pool;
+        QVector<Key> keys;
+        int sortedCount;
+
+        void clear();
+        void add(const QString &key, int record);
+        void sort();
+        void remove(int record);
+        void find(const QString &prefix, QVector<int> *records) const;
+    };
+
+    // orders keys by their text, the record breaks ties
+    struct KeyLess {
+        const QString *pool;
+        bool operator()(const Key &a, const Key &b) const;
+        bool operator()(const Key &a, const QString &text) const;
+    };
+
+    void addRecord(const ContactStore &store, int record);
+    static QString phoneKey(const QStringRef &value);
+    KeyList names;
+    KeyList phones;
+    int indexedCount;
+};
+
+#endif // CONTACTINDEX_H
@@ -0,0 +1,219 @@
+/********************************************************************
+
+Name: Versatacts
+Homepage: http://github.com/ae5chylu5/versatacts
+Author: ae5chylu5
+Description: A versatile gui application capable of extracting and
+             converting contacts to/from a variety of popular
+             mobile formats.
+
+Copyright (C) 2016 ae5chylu5
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+********************************************************************/
+
+#include "contactmodel.h"
+
+ContactModel::ContactModel(ContactStore *store, QObject *parent)
+    : QAbstractListModel(parent), store(store), isSuspended(false), hasFilter(false)
+{
+
+}
+
+int ContactModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid() || isSuspended) return 0;
+    return hasFilter ? filter.count() : store->count();
+}
+
+QVariant ContactModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || isSuspended || index.row() >= rowCount()) return QVariant();
+
+    if (role == Qt::DisplayRole) return summary(record(index.row()));
+
+    if (role == Qt::EditRole || role == Qt::ToolTipRole) {
+        QString card;
+        VcfWriter::formatRecord(*store, record(index.row()), card);
+        return card;
+    }
+
+    return QVariant();
+}
+
+bool ContactModel::setData(const QModelIndex &index, const QVariant &value, int role)
+{
+    if (role != Qt::EditRole || !index.isValid() || isSuspended || index.row() >= rowCount()) return false;
+
+    QStringList lines = value.toString().split('\n', QString::SkipEmptyParts);
+    QStringList names;
+    QString line;
+    int edited = record(index.row());
+    ContactStore::FieldKind kind;
+    ContactStore::FieldParam param;
+    int colon;
+
+    // the edited card is parsed the same way merged vcf files are. known
+    // properties get their kind back, everything else is kept as is.
+    for (int i=0; i<lines.count(); i++) {
+        line = lines[i].trimmed();
+
+        if (line.isEmpty() ||
+            line.startsWith("BEGIN:", Qt::CaseInsensitive) ||
+            line.startsWith("VERSION:", Qt::CaseInsensitive) ||
+            line.startsWith("END:", Qt::CaseInsensitive) ||
+            line.startsWith("n:", Qt::CaseInsensitive)) continue;
+
+        if (line.startsWith("FN:", Qt::CaseInsensitive)) {
+            names = line.mid(3).split(" ", QString::SkipEmptyParts);
+            if (names.isEmpty()) continue;
+            store->addField(ContactStore::FirstName, names.takeFirst());
+            if (names.count() > 0) store->addField(ContactStore::LastName, names.join(" "));
+            continue;
+        }
+
+        colon = line.indexOf(':');
+        kind = colon > 0 ? ContactStore::kindForProperty(line.left(colon), &param) : ContactStore::Raw;
+        if (kind == ContactStore::Raw) {
+            store->addField(ContactStore::Raw, line);
+        } else {
+            store->addField(kind, line.midRef(colon + 1), param);
+        }
+    }
+
+    // photos aren't part of the card text so the ones of the old record
+    // are carried over
+    for (int j=0; j<store->fieldCount(edited); j++) {
+        ContactStore::Field f = store->field(edited, j);
+        if (f.kind != ContactStore::Binary) continue;
+        // copied first, adding to the pool may move it
+        QByteArray bytes(store->binary(f).constData(), f.length);
+        store->addBinaryField(bytes.constData(), bytes.size());
+    }
+
+    store->replaceRecord(edited);
+    emit dataChanged(index, index);
+    return true;
+}
+
+Qt::ItemFlags ContactModel::flags(const QModelIndex &index) const
+{
+    if (!index.isValid()) return Qt::NoItemFlags;
+    return Qt::ItemIsSelectable | Qt::ItemIsEnabled | Qt::ItemIsEditable;
+}
+
+// call after the store was changed outside of the model. the filter
+// no longer applies to the new records so it is dropped.
+void ContactModel::reload()
+{
+    beginResetModel();
+    filter.clear();
+    hasFilter = false;
+    endResetModel();
+}
+
+// repaints records that were changed outside of the model without a
+// reset so the selection and scroll position survive. records must be
+// in ascending order, runs of consecutive rows are reported together.
+void ContactModel::updateRecords(const QVector<int> &records)
+{
+    if (isSuspended) return;
+
+    // records that are filtered out don't have a row
+    QVector<int> rows;
+    if (hasFilter) {
+        QVector<int>::const_iterator it = filter.constBegin();
+        for (int i=0; i<records.count(); i++) {
+            it = std::lower_bound(it, filter.constEnd(), records.at(i));
+            if (it == filter.constEnd()) break;
+            if (*it == records.at(i)) rows.append(it - filter.constBegin());
+        }
+    } else {
+        rows = records;
+    }
+
+    int first = 0;
+    for (int i=1; i<=rows.count(); i++) {
+        if (i < rows.count() && rows.at(i) == rows.at(i - 1) + 1) continue;
+        emit dataChanged(index(rows.at(first)), index(rows.at(i - 1)));
+        first = i;
+    }
+}
+
+// the store must not be read while a job on another thread changes it
+void ContactModel::setSuspended(bool suspended)
+{
+    beginResetModel();
+    isSuspended = suspended;
+    filter.clear();
+    hasFilter = false;
+    endResetModel();
+}
+
+// shows only the given records, which must be in ascending order
+void ContactModel::setFilter(const QVector<int> &records)
+{
+    beginResetModel();
+    filter = records;
+    hasFilter = true;
+    endResetModel();
+}
+
+void ContactModel::clearFilter()
+{
+    if (!hasFilter) return;
+
+    beginResetModel();
+    filter.clear();
+    hasFilter = false;
+    endResetModel();
+}
+
+bool ContactModel::isFiltered() const
+{
+    return hasFilter;
+}
+
+// the record shown in row
+int ContactModel::record(int row) const
+{
+    return hasFilter ? filter.at(row) : row;
+}
+
+// first and last name followed by the first value that isn't a name
+QString ContactModel::summary(int record) const
+{
+    QString text;
+    QString detail;
+    int fieldCount = store->fieldCount(record);
+    int colon;
+
+    for (int j=0; j<fieldCount; j++) {
+        const ContactStore::Field &f = store->field(record, j);
+        if (f.kind == ContactStore::FirstName || f.kind == ContactStore::LastName) {
+            if (!text.isEmpty()) text.append(QLatin1Char(' '));
+            text.append(store->value(f));
+        } else if (detail.isEmpty()) {
+            QStringRef value = store->value(f);
+            // raw lines still carry their property name
+            colon = f.kind == ContactStore::Raw ? value.indexOf(QLatin1Char(':')) : -1;
+            detail = value.mid(colon + 1).toString();
+        }
+    }
+
+    if (detail.isEmpty()) return text;
+    if (text.isEmpty()) return detail;
+    return text + " - " + detail;
+}
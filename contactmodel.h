@@ -0,0 +1,76 @@
+/********************************************************************
+
+Name: Versatacts
+Homepage: http://github.com/ae5chylu5/versatacts
+Author: ae5chylu5
+Description: A versatile gui application capable of extracting and
+             converting contacts to/from a variety of popular
+             mobile formats.
+
+Copyright (C) 2016 ae5chylu5
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+********************************************************************/
+
+#ifndef CONTACTMODEL_H
+#define CONTACTMODEL_H
+
+#include "contactstore.h"
+#include "vcfwriter.h"
+
+#include <QAbstractListModel>
+#include <QByteArray>
+#include <QStringList>
+#include <QVector>
+
+#include <algorithm>
+
+// ContactModel exposes the records of a ContactStore to the views. it
+// doesn't cache anything, a row is only formatted when the view asks
+// for it so memory stays flat no matter how many records are loaded.
+//
+// the display role is a one line summary, the edit and tooltip roles
+// hold the complete vcard. while a background job modifies the store
+// the model is suspended and appears empty.
+//
+// a filter limits the rows to a list of records, usually the result of
+// a ContactIndex search. rows and records only differ while it is set.
+class ContactModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    ContactModel(ContactStore *store, QObject *parent = 0);
+    int rowCount(const QModelIndex &parent = QModelIndex()) const;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+    bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole);
+    Qt::ItemFlags flags(const QModelIndex &index) const;
+    void reload();
+    void updateRecords(const QVector<int> &records);
+    void setSuspended(bool suspended);
+    void setFilter(const QVector<int> &records);
+    void clearFilter();
+    bool isFiltered() const;
+    int record(int row) const;
+
+private:
+    QString summary(int record) const;
+    ContactStore *store;
+    QVector<int> filter; // records shown, in ascending order
+    bool isSuspended;
+    bool hasFilter;
+};
+
+#endif // CONTACTMODEL_H
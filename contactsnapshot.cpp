@@ -0,0 +1,251 @@
+/********************************************************************
+
+Name: Versatacts
+Homepage: http://github.com/ae5chylu5/versatacts
+Author: ae5chylu5
+Description: A versatile gui application capable of extracting and
+             converting contacts to/from a variety of popular
+             mobile formats.
+
+Copyright (C) 2016 ae5chylu5
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+********************************************************************/
+
+#include "contactsnapshot.h"
+
+const char ContactSnapshot::magic[4] = {'V', 'C', 'S', 'N'};
+
+// only committed records are written. fields and text left behind by
+// edits are dropped so the pools are compacted on the way.
+bool ContactSnapshot::save(const ContactStore &store, const QString &path)
+{
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) return false;
+
+    quint32 recordCount = store.recordList.count();
+    quint32 fieldCount = 0;
+    quint64 poolLength = 0;
+    quint64 binaryLength = 0;
+    for (int i=0; i<store.recordList.count(); i++) {
+        const ContactStore::Record &r = store.recordList.at(i);
+        fieldCount += r.count;
+        for (int j=r.first; j<r.first + r.count; j++) {
+            const ContactStore::Field &f = store.fields.at(j);
+            if (f.kind == ContactStore::Binary) {
+                binaryLength += f.length;
+            } else {
+                poolLength += f.length;
+            }
+        }
+    }
+
+    quint64 recordsOffset = headerSize;
+    quint64 fieldsOffset = recordsOffset + quint64(recordCount) * recordSize;
+    quint64 poolOffset = fieldsOffset + quint64(fieldCount) * fieldSize;
+    quint64 binaryOffset = poolOffset + poolLength * 2;
+
+    uchar header[headerSize];
+    memset(header, 0, headerSize);
+    memcpy(header, magic, 4);
+    qToLittleEndian<quint32>(version, header + 4);
+    qToLittleEndian<quint32>(recordCount, header + 8);
+    qToLittleEndian<quint32>(fieldCount, header + 12);
+    qToLittleEndian<quint64>(poolLength, header + 16);
+    qToLittleEndian<quint64>(binaryLength, header + 24);
+    qToLittleEndian<quint64>(recordsOffset, header + 32);
+    qToLittleEndian<quint64>(fieldsOffset, header + 40);
+    qToLittleEndian<quint64>(poolOffset, header + 48);
+    qToLittleEndian<quint64>(binaryOffset, header + 56);
+    file.write(reinterpret_cast<const char *>(header), headerSize);
+
+    // the record index
+    uchar entry[fieldSize];
+    quint32 first = 0;
+    for (int i=0; i<store.recordList.count(); i++) {
+        qToLittleEndian<quint32>(first, entry);
+        qToLittleEndian<quint32>(store.recordList.at(i).count, entry + 4);
+        file.write(reinterpret_cast<const char *>(entry), recordSize);
+        first += store.recordList.at(i).count;
+    }
+
+    // the field descriptors with offsets into the compacted pools
+    quint32 poolPos = 0;
+    quint32 binaryPos = 0;
+    memset(entry, 0, fieldSize);
+    for (int i=0; i<store.recordList.count(); i++) {
+        const ContactStore::Record &r = store.recordList.at(i);
+        for (int j=r.first; j<r.first + r.count; j++) {
+            const ContactStore::Field &f = store.fields.at(j);
+            quint32 &pos = f.kind == ContactStore::Binary ? binaryPos : poolPos;
+            qToLittleEndian<quint32>(pos, entry);
+            qToLittleEndian<quint32>(f.length, entry + 4);
+            entry[8] = f.kind;
+            entry[9] = f.param;
+            file.write(reinterpret_cast<const char *>(entry), fieldSize);
+            pos += f.length;
+        }
+    }
+
+    // the text of every field in the same order
+    for (int i=0; i<store.recordList.count(); i++) {
+        const ContactStore::Record &r = store.recordList.at(i);
+        for (int j=r.first; j<r.first + r.count; j++) {
+            const ContactStore::Field &f = store.fields.at(j);
+            if (f.kind == ContactStore::Binary) continue;
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+            file.write(reinterpret_cast<const char *>(store.pool.constData() + f.offset), f.length * 2);
+#else
+            QByteArray chunk(f.length * 2, 0);
+            for (int k=0; k<f.length; k++) {
+                qToLittleEndian<quint16>(store.pool.at(f.offset + k).unicode(),
+                                         reinterpret_cast<uchar *>(chunk.data()) + k * 2);
+            }
+            file.write(chunk);
+#endif
+        }
+    }
+
+    for (int i=0; i<store.recordList.count(); i++) {
+        const ContactStore::Record &r = store.recordList.at(i);
+        for (int j=r.first; j<r.first + r.count; j++) {
+            const ContactStore::Field &f = store.fields.at(j);
+            if (f.kind == ContactStore::Binary) file.write(store.binaryPool.constData() + f.offset, f.length);
+        }
+    }
+
+    return file.commit();
+}
+
+// returns false if the file isn't a snapshot of this version or any of
+// its tables points outside of it. the store is left empty then.
+bool ContactSnapshot::load(const QString &path, ContactStore *store)
+{
+    store->clear();
+
+    QSharedPointer<QFile> file(new QFile(path));
+    if (!file->open(QIODevice::ReadOnly)) return false;
+
+    qint64 size = file->size();
+    if (size < headerSize) return false;
+
+    // files that can't be mapped are read in one go instead
+    QByteArray buffer;
+    const uchar *data = file->map(0, size);
+    if (!data) {
+        buffer = file->readAll();
+        data = reinterpret_cast<const uchar *>(buffer.constData());
+    }
+
+    if (memcmp(data, magic, 4) != 0 || qFromLittleEndian<quint32>(data + 4) != version) return false;
+
+    quint32 recordCount = qFromLittleEndian<quint32>(data + 8);
+    quint32 fieldCount = qFromLittleEndian<quint32>(data + 12);
+    quint64 poolLength = qFromLittleEndian<quint64>(data + 16);
+    quint64 binaryLength = qFromLittleEndian<quint64>(data + 24);
+    quint64 recordsOffset = qFromLittleEndian<quint64>(data + 32);
+    quint64 fieldsOffset = qFromLittleEndian<quint64>(data + 40);
+    quint64 poolOffset = qFromLittleEndian<quint64>(data + 48);
+    quint64 binaryOffset = qFromLittleEndian<quint64>(data + 56);
+
+    if (recordsOffset + quint64(recordCount) * recordSize > quint64(size) || recordsOffset % 4 != 0 ||
+        fieldsOffset + quint64(fieldCount) * fieldSize > quint64(size) || fieldsOffset % 4 != 0 ||
+        poolOffset + poolLength * 2 > quint64(size) || poolOffset % 2 != 0 ||
+        binaryOffset + binaryLength > quint64(size) ||
+        recordCount > quint32(INT_MAX) || fieldCount > quint32(INT_MAX) ||
+        poolLength > quint64(INT_MAX) || binaryLength > quint64(INT_MAX)) return false;
+
+    // a mapped snapshot is used as it is. the tables have the layout of
+    // the arrays of the store and the first change to a table or pool
+    // copies it.
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    Q_STATIC_ASSERT(sizeof(ContactStore::Field) == fieldSize && sizeof(ContactStore::Record) == recordSize);
+    if (buffer.isEmpty()) {
+        store->fields = MappedVector<ContactStore::Field>::fromRawData(
+                    reinterpret_cast<const ContactStore::Field *>(data + fieldsOffset), fieldCount);
+        store->recordList = MappedVector<ContactStore::Record>::fromRawData(
+                    reinterpret_cast<const ContactStore::Record *>(data + recordsOffset), recordCount);
+        store->openFirst = fieldCount;
+        store->pool = QString::fromRawData(reinterpret_cast<const QChar *>(data + poolOffset), poolLength);
+        store->binaryPool = QByteArray::fromRawData(reinterpret_cast<const char *>(data + binaryOffset), binaryLength);
+        store->backing = file;
+        if (hasValidTables(*store, poolLength, binaryLength)) return true;
+        store->clear();
+        return false;
+    }
+#endif
+
+    // a snapshot that has to be read is converted entry by entry
+    store->fields.resize(fieldCount);
+    const uchar *entry = data + fieldsOffset;
+    for (quint32 j=0; j<fieldCount; j++, entry += fieldSize) {
+        ContactStore::Field &f = store->fields[j];
+        f.offset = qFromLittleEndian<quint32>(entry);
+        f.length = qFromLittleEndian<quint32>(entry + 4);
+        f.kind = entry[8];
+        f.param = entry[9];
+    }
+
+    store->recordList.resize(recordCount);
+    entry = data + recordsOffset;
+    for (quint32 i=0; i<recordCount; i++, entry += recordSize) {
+        ContactStore::Record &r = store->recordList[i];
+        r.first = qFromLittleEndian<quint32>(entry);
+        r.count = qFromLittleEndian<quint32>(entry + 4);
+    }
+    store->openFirst = store->fields.count();
+
+    if (!hasValidTables(*store, poolLength, binaryLength)) {
+        store->clear();
+        return false;
+    }
+
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    store->pool = QString(reinterpret_cast<const QChar *>(data + poolOffset), poolLength);
+#else
+    store->pool.resize(poolLength);
+    for (quint64 k=0; k<poolLength; k++) {
+        store->pool[int(k)] = QChar(qFromLittleEndian<quint16>(data + poolOffset + k * 2));
+    }
+#endif
+    store->binaryPool = QByteArray(reinterpret_cast<const char *>(data + binaryOffset), binaryLength);
+    return true;
+}
+
+// true if every field lies inside its pool and every record inside the
+// field table. a damaged or foreign file would otherwise make the
+// accessors of the store read outside of the mapping.
+bool ContactSnapshot::hasValidTables(const ContactStore &store, quint64 poolLength, quint64 binaryLength)
+{
+    for (int j=0; j<store.fields.count(); j++) {
+        const ContactStore::Field &f = store.fields.at(j);
+        quint64 poolSize = f.kind == ContactStore::Binary ? binaryLength : poolLength;
+        if (f.kind > ContactStore::Binary || f.param > ContactStore::Other ||
+            f.offset < 0 || f.length < 0 || quint64(f.offset) + quint64(f.length) > poolSize) return false;
+    }
+
+    quint64 fieldCount = store.fields.count();
+    for (int i=0; i<store.recordList.count(); i++) {
+        const ContactStore::Record &r = store.recordList.at(i);
+        if (r.first < 0 || r.count < 0 || quint64(r.first) + quint64(r.count) > fieldCount) return false;
+    }
+    return true;
+}
+
+// true if data starts like a snapshot of any version
+bool ContactSnapshot::isSnapshot(const char *data, qint64 size)
+{
+    return size >= 4 && memcmp(data, magic, 4) == 0;
+}
@@ -0,0 +1,73 @@
+/********************************************************************
+
+Name: Versatacts
+Homepage: http://github.com/ae5chylu5/versatacts
+Author: ae5chylu5
+Description: A versatile gui application capable of extracting and
+             converting contacts to/from a variety of popular
+             mobile formats.
+
+Copyright (C) 2016 ae5chylu5
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+********************************************************************/
+
+#ifndef CONTACTSNAPSHOT_H
+#define CONTACTSNAPSHOT_H
+
+#include "contactstore.h"
+
+#include <QFile>
+#include <QIODevice>
+#include <QSaveFile>
+#include <QSharedPointer>
+#include <QString>
+#include <QtEndian>
+
+#include <limits.h>
+#include <string.h>
+
+// ContactSnapshot saves a ContactStore in a binary file which can be
+// memory mapped when it is loaded again. all numbers are little endian.
+//
+//   header    64 bytes, see below
+//   records   recordCount * {u32 first field, u32 field count}
+//   fields    fieldCount * {u32 offset, u32 length, u8 kind, u8 param, u16 0}
+//   pool      poolLength utf-16 code units
+//   binary    binaryLength bytes
+//
+// on little endian hosts loading a mapped snapshot copies nothing. the
+// tables and pools of the store point into the mapping which stays open
+// as long as the store uses it. a snapshot that can't be mapped, or a big
+// endian host, converts every entry. either way every entry of the tables
+// is checked against the pools before the store is used, the text itself
+// is only read when it is first needed.
+class ContactSnapshot
+{
+public:
+    static bool save(const ContactStore &store, const QString &path);
+    static bool load(const QString &path, ContactStore *store);
+    static bool isSnapshot(const char *data, qint64 size);
+
+private:
+    static bool hasValidTables(const ContactStore &store, quint64 poolLength, quint64 binaryLength);
+    static const char magic[4];
+    static const quint32 version = 1;
+    static const int headerSize = 64;
+    static const int recordSize = 8;
+    static const int fieldSize = 12;
+};
+
+#endif // CONTACTSNAPSHOT_H
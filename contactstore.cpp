@@ -0,0 +1,337 @@
+/********************************************************************
+
+Name: Versatacts
+Homepage: http://github.com/ae5chylu5/versatacts
+Author: ae5chylu5
+Description: A versatile gui application capable of extracting and
+             converting contacts to/from a variety of popular
+             mobile formats.
+
+Copyright (C) 2016 ae5chylu5
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+********************************************************************/
+
+#include "contactstore.h"
+
+ContactStore::ContactStore()
+{
+    openFirst = 0;
+}
+
+void ContactStore::clear()
+{
+    pool.clear();
+    binaryPool.clear();
+    fields.clear();
+    recordList.clear();
+    openFirst = 0;
+    backing.clear();
+}
+
+int ContactStore::count() const
+{
+    return recordList.count();
+}
+
+bool ContactStore::isEmpty() const
+{
+    return recordList.isEmpty();
+}
+
+int ContactStore::fieldCount(int record) const
+{
+    return recordList.at(record).count;
+}
+
+ContactStore::Field &ContactStore::field(int record, int index)
+{
+    return fields[recordList.at(record).first + index];
+}
+
+const ContactStore::Field &ContactStore::field(int record, int index) const
+{
+    return fields.at(recordList.at(record).first + index);
+}
+
+QStringRef ContactStore::value(const Field &f) const
+{
+    if (f.kind == Binary) return QStringRef();
+    return QStringRef(&pool, f.offset, f.length);
+}
+
+// the bytes of a binary field. the array doesn't own them so it is only
+// valid until the next binary field is added.
+QByteArray ContactStore::binary(const Field &f) const
+{
+    if (f.kind != Binary) return QByteArray();
+    return QByteArray::fromRawData(binaryPool.constData() + f.offset, f.length);
+}
+
+QChar *ContactStore::valueData(const Field &f)
+{
+    return pool.data() + f.offset;
+}
+
+void ContactStore::setValue(Field &f, const QString &value)
+{
+    // shorter values are overwritten in place. anything longer goes to
+    // the end of the pool.
+    if (value.length() > f.length) {
+        f.offset = pool.length();
+        pool.append(value);
+    } else {
+        QChar *data = pool.data() + f.offset;
+        for (int i=0; i<value.length(); i++) data[i] = value.at(i);
+    }
+    f.length = value.length();
+}
+
+void ContactStore::removeField(int record, int index)
+{
+    Record &r = recordList[record];
+    for (int i=r.first + index; i<r.first + r.count - 1; i++) fields[i] = fields.at(i + 1);
+    r.count--;
+}
+
+void ContactStore::swapValues(Field &a, Field &b)
+{
+    qSwap(a.offset, b.offset);
+    qSwap(a.length, b.length);
+}
+
+void ContactStore::addField(FieldKind kind, const QString &value, FieldParam param)
+{
+    addField(kind, QStringRef(&value), param);
+}
+
+void ContactStore::addField(FieldKind kind, const QStringRef &value, FieldParam param)
+{
+    Field f;
+    f.offset = pool.length();
+    f.length = value.length();
+    f.kind = kind;
+    f.param = param;
+    pool.append(value);
+    fields.append(f);
+}
+
+void ContactStore::addBinaryField(const char *data, int length)
+{
+    Field f;
+    f.offset = binaryPool.size();
+    f.length = length;
+    f.kind = Binary;
+    f.param = NoParam;
+    binaryPool.append(data, length);
+    fields.append(f);
+}
+
+// places a field at index of the open record. only the fields of the
+// open record have to move.
+void ContactStore::insertField(int index, FieldKind kind, const QString &value, FieldParam param)
+{
+    Field f;
+    f.offset = pool.length();
+    f.length = value.length();
+    f.kind = kind;
+    f.param = param;
+    pool.append(value);
+    fields.insert(openFirst + qMin(index, fields.count() - openFirst), f);
+}
+
+void ContactStore::addRecord(const QStringList &values, FieldKind kind)
+{
+    for (int i=0; i<values.count(); i++) addField(kind, values.at(i));
+    endRecord();
+}
+
+// copies the committed records of other to the end of this store. the
+// open record of this store must be empty.
+void ContactStore::append(const ContactStore &other)
+{
+    int poolBase = pool.length();
+    int binaryBase = binaryPool.size();
+    int fieldBase = fields.count();
+
+    pool.append(other.pool);
+    binaryPool.append(other.binaryPool);
+
+    fields.reserve(fieldBase + other.openFirst);
+    for (int i=0; i<other.openFirst; i++) {
+        Field f = other.fields.at(i);
+        f.offset += f.kind == Binary ? binaryBase : poolBase;
+        fields.append(f);
+    }
+
+    recordList.reserve(recordList.count() + other.recordList.count());
+    for (int i=0; i<other.recordList.count(); i++) {
+        Record r = other.recordList.at(i);
+        r.first += fieldBase;
+        recordList.append(r);
+    }
+
+    openFirst = fields.count();
+}
+
+void ContactStore::endRecord()
+{
+    // empty records are never committed
+    if (fields.count() == openFirst) return;
+
+    Record r;
+    r.first = openFirst;
+    r.count = fields.count() - openFirst;
+    recordList.append(r);
+    openFirst = fields.count();
+}
+
+void ContactStore::discardRecord()
+{
+    // the text of the dropped fields stays in the pool until clear()
+    fields.resize(openFirst);
+}
+
+// the open record takes the place of an existing one. the old fields
+// are left unused in the arrays until clear().
+void ContactStore::replaceRecord(int record)
+{
+    Record &r = recordList[record];
+    r.first = openFirst;
+    r.count = fields.count() - openFirst;
+    openFirst = fields.count();
+}
+
+// adds a field to the open record that shares the value of f. nothing
+// is copied into the pools.
+void ContactStore::copyField(const Field &f)
+{
+    fields.append(f);
+}
+
+// drops the records marked in removed and keeps the rest in order. their
+// fields are left unused in the arrays until clear().
+void ContactStore::removeRecords(const QVector<bool> &removed)
+{
+    int kept = 0;
+    for (int i=0; i<recordList.count(); i++) {
+        if (removed.at(i)) continue;
+        recordList[kept++] = recordList.at(i);
+    }
+    recordList.resize(kept);
+}
+
+const char *ContactStore::propertyName(const Field &f)
+{
+    switch (f.kind) {
+    case Tel:
+        switch (f.param) {
+        case Cell: return "TEL;TYPE=CELL";
+        case Home: return "TEL;TYPE=HOME";
+        case Work: return "TEL;TYPE=WORK";
+        case Other: return "TEL;TYPE=OTHER";
+        default: return "TEL";
+        }
+    case Email:
+        switch (f.param) {
+        case Home: return "EMAIL;TYPE=HOME";
+        case Work: return "EMAIL;TYPE=WORK";
+        case Other: return "EMAIL;TYPE=OTHER";
+        default: return "EMAIL";
+        }
+    case Url: return "URL";
+    case Address: return "ADR";
+    case Note: return "NOTE";
+    default: return 0;
+    }
+}
+
+// reverse of propertyName(). anything that isn't one of the classified
+// properties is Raw.
+ContactStore::FieldKind ContactStore::kindForProperty(const QString &property, FieldParam *param)
+{
+    static const FieldKind kinds[] = { Tel, Email, Url, Address, Note };
+    const char *name;
+    Field f;
+
+    for (uint i=0; i<sizeof(kinds) / sizeof(kinds[0]); i++) {
+        for (int j=NoParam; j<=Other; j++) {
+            f.kind = kinds[i];
+            f.param = j;
+            name = propertyName(f);
+            if (property.compare(QLatin1String(name), Qt::CaseInsensitive) == 0) {
+                *param = static_cast<FieldParam>(j);
+                return kinds[i];
+            }
+        }
+    }
+
+    *param = NoParam;
+    return Raw;
+}
+
+// only the committed records are written. their fields are stored one
+// record after another so removed or replaced fields are left out.
+QDataStream &operator<<(QDataStream &out, const ContactStore &store)
+{
+    out << store.pool << store.binaryPool << qint32(store.recordList.count());
+    for (int i=0; i<store.recordList.count(); i++) {
+        const ContactStore::Record &r = store.recordList.at(i);
+        out << qint32(r.count);
+        for (int j=r.first; j<r.first + r.count; j++) {
+            const ContactStore::Field &f = store.fields.at(j);
+            out << qint32(f.offset) << qint32(f.length) << f.kind << f.param;
+        }
+    }
+    return out;
+}
+
+QDataStream &operator>>(QDataStream &in, ContactStore &store)
+{
+    qint32 recordCount,fieldCount,offset,length;
+    ContactStore::Field f;
+
+    store.clear();
+    in >> store.pool >> store.binaryPool >> recordCount;
+    for (int i=0; i<recordCount && in.status() == QDataStream::Ok; i++) {
+        in >> fieldCount;
+        for (int j=0; j<fieldCount && in.status() == QDataStream::Ok; j++) {
+            in >> offset >> length >> f.kind >> f.param;
+            int poolLength = f.kind == ContactStore::Binary ? store.binaryPool.size() : store.pool.length();
+            if (offset < 0 || length < 0 || offset + length > poolLength) {
+                in.setStatus(QDataStream::ReadCorruptData);
+                break;
+            }
+            f.offset = offset;
+            f.length = length;
+            store.fields.append(f);
+        }
+        store.endRecord();
+    }
+
+    if (in.status() != QDataStream::Ok) store.clear();
+    return in;
+}
+
+// gives the store its own copy of every array, e.g. of a snapshot
+// mapping or a store it was copied from, so writing to the fields of a
+// record doesn't copy anything later
+void ContactStore::detach()
+{
+    pool.data();
+    binaryPool.data();
+    fields.data();
+    recordList.data();
+}
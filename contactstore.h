@@ -0,0 +1,131 @@
+/********************************************************************
+
+Name: Versatacts
+Homepage: http://github.com/ae5chylu5/versatacts
+Author: ae5chylu5
+Description: A versatile gui application capable of extracting and
+             converting contacts to/from a variety of popular
+             mobile formats.
+
+Copyright (C) 2016 ae5chylu5
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+********************************************************************/
+
+#ifndef CONTACTSTORE_H
+#define CONTACTSTORE_H
+
+#include "mappedvector.h"
+
+#include <QByteArray>
+#include <QDataStream>
+#include <QFile>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+#include <QStringRef>
+#include <QVector>
+
+// ContactStore keeps every imported contact in a few flat arrays. the
+// text of all fields lives in a single string pool and each field only
+// stores its kind, an optional type parameter and the position of its
+// value in the pool. records are ranges of consecutive fields.
+//
+// fields are appended to an open record which is committed with
+// endRecord(). references returned by field() are only valid until the
+// next field is added.
+//
+// binary properties such as photos are kept as bytes in a pool of their
+// own. they never pass through a QString and value() is empty for them.
+//
+// after detach() several threads may change the fields of different
+// records at once as long as none of them adds or inserts fields.
+class ContactStore
+{
+public:
+    enum FieldKind {
+        Unknown, // unclassified value, written as is
+        FirstName,
+        LastName,
+        Tel,
+        Email,
+        Url,
+        Address,
+        Note,
+        Raw, // complete vcf line including the property name
+        Binary // complete vcf line kept as bytes, e.g. a base64 photo
+    };
+
+    enum FieldParam {
+        NoParam,
+        Cell,
+        Home,
+        Work,
+        Other
+    };
+
+    struct Field {
+        int offset;
+        int length;
+        quint8 kind;
+        quint8 param;
+    };
+
+    ContactStore();
+    void clear();
+    int count() const;
+    bool isEmpty() const;
+    int fieldCount(int record) const;
+    Field &field(int record, int index);
+    const Field &field(int record, int index) const;
+    QStringRef value(const Field &f) const;
+    QByteArray binary(const Field &f) const;
+    QChar *valueData(const Field &f);
+    void setValue(Field &f, const QString &value);
+    void removeField(int record, int index);
+    void swapValues(Field &a, Field &b);
+    void addField(FieldKind kind, const QString &value, FieldParam param = NoParam);
+    void addField(FieldKind kind, const QStringRef &value, FieldParam param = NoParam);
+    void addBinaryField(const char *data, int length);
+    void insertField(int index, FieldKind kind, const QString &value, FieldParam param = NoParam);
+    void addRecord(const QStringList &values, FieldKind kind = Unknown);
+    void append(const ContactStore &other);
+    void endRecord();
+    void discardRecord();
+    void replaceRecord(int record);
+    void copyField(const Field &f);
+    void removeRecords(const QVector<bool> &removed);
+    void detach();
+    static const char *propertyName(const Field &f);
+    static FieldKind kindForProperty(const QString &property, FieldParam *param);
+    friend QDataStream &operator<<(QDataStream &out, const ContactStore &store);
+    friend QDataStream &operator>>(QDataStream &in, ContactStore &store);
+    friend class ContactSnapshot;
+
+private:
+    struct Record {
+        int first;
+        int count;
+    };
+
+    QSharedPointer<QFile> backing; // mapped snapshot the pools may point into
+    QString pool;
+    QByteArray binaryPool;
+    MappedVector<Field> fields;
+    MappedVector<Record> recordList;
+    int openFirst; // index of the first field of the open record
+};
+
+#endif // CONTACTSTORE_H
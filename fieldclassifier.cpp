@@ -0,0 +1,158 @@
+/********************************************************************
+
+Name: Versatacts
+Homepage: http://github.com/ae5chylu5/versatacts
+Author: ae5chylu5
+Description: A versatile gui application capable of extracting and
+             converting contacts to/from a variety of popular
+             mobile formats.
+
+Copyright (C) 2016 ae5chylu5
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+********************************************************************/
+
+#include "fieldclassifier.h"
+
+namespace {
+
+enum CharFlag {
+    WordChar = 0x01,  // \w
+    DigitChar = 0x02, // \d
+    NameChar = 0x04,  // [A-Za-z_\- \.]
+    ValidChar = 0x08, // [\w\.\+ \#\@\-\,\:\/]
+    LeadChar = 0x10   // [\w\+\#]
+};
+
+struct CharTable
+{
+    quint8 flags[128];
+
+    CharTable()
+    {
+        for (int c=0; c<128; c++) {
+            bool isAlpha = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+            bool isDigit = c >= '0' && c <= '9';
+            bool isWord = isAlpha || isDigit || c == '_';
+            quint8 f = 0;
+            if (isWord) f |= WordChar | ValidChar | LeadChar;
+            if (isDigit) f |= DigitChar;
+            if (isAlpha || c == '_' || c == '-' || c == ' ' || c == '.') f |= NameChar;
+            if (c == '.' || c == '+' || c == ' ' || c == '#' || c == '@' ||
+                c == '-' || c == ',' || c == ':' || c == '/') f |= ValidChar;
+            if (c == '+' || c == '#') f |= LeadChar;
+            flags[c] = f;
+        }
+    }
+};
+
+const quint8 *charTable()
+{
+    static const CharTable table;
+    return table.flags;
+}
+
+inline uint charFlags(const quint8 *table, QChar c)
+{
+    ushort u = c.unicode();
+    if (u < 128) return table[u];
+
+    // slow path for everything outside of the ascii range
+    uint f = 0;
+    if (c.isLetterOrNumber() || c.isMark()) f |= WordChar | ValidChar | LeadChar;
+    if (c.isDigit()) f |= DigitChar;
+    return f;
+}
+
+}
+
+// strips the invalid characters in place and trims the edges. returns
+// the length of the remaining value which starts at data + *start.
+int FieldClassifier::sanitize(QChar *data, int length, int *start)
+{
+    const quint8 *table = charTable();
+    int total = 0;
+    int first = -1; // first character that may start a value
+    int last = -1; // last word character
+    uint f;
+
+    for (int i=0; i<length; i++) {
+        f = charFlags(table, data[i]);
+        if (!(f & ValidChar)) continue;
+        if (first < 0 && (f & LeadChar)) first = total;
+        if (f & WordChar) last = total;
+        data[total++] = data[i];
+    }
+
+    *start = 0;
+    if (first < 0 || last < first) return 0;
+
+    *start = first;
+    return last - first + 1;
+}
+
+// returns the kind of a sanitized value. names are only detected when
+// allowLastName is set since only the second entry of a record may be
+// a last name.
+ContactStore::FieldKind FieldClassifier::classify(const QChar *data, int length, bool allowLastName)
+{
+    const quint8 *table = charTable();
+    uint common = ~0u; // flags shared by every character
+    bool hasAt = false;
+    bool hasScheme = false;
+
+    for (int i=0; i<length; i++) {
+        common &= charFlags(table, data[i]);
+        if (data[i] == QLatin1Char('@')) {
+            hasAt = true;
+        } else if (data[i] == QLatin1Char(':') && i + 2 < length &&
+                   data[i + 1] == QLatin1Char('/') && data[i + 2] == QLatin1Char('/')) {
+            hasScheme = true;
+        }
+    }
+
+    if (allowLastName && length > 0 && (common & NameChar)) return ContactStore::LastName;
+    if (isPhone(data, length)) return ContactStore::Tel;
+    if (hasAt) return ContactStore::Email;
+    if (hasScheme) return ContactStore::Url;
+    if (isAddress(data, length)) return ContactStore::Address;
+    return ContactStore::Note;
+}
+
+bool FieldClassifier::isPhone(const QChar *data, int length)
+{
+    const quint8 *table = charTable();
+    int i = 0;
+    if (length > 0 && (data[0] == QLatin1Char('#') || data[0] == QLatin1Char('+'))) i = 1;
+    if (length - i < 2 || length - i > 11) return false;
+    for (; i<length; i++) {
+        if (!(charFlags(table, data[i]) & DigitChar)) return false;
+    }
+    return true;
+}
+
+bool FieldClassifier::isPhone(const QString &value)
+{
+    return isPhone(value.constData(), value.length());
+}
+
+bool FieldClassifier::isAddress(const QChar *data, int length)
+{
+    const quint8 *table = charTable();
+    int i = 0;
+    while (i < length && (charFlags(table, data[i]) & DigitChar)) i++;
+    return i > 0 && i + 1 < length && data[i] == QLatin1Char(' ') &&
+           (charFlags(table, data[i + 1]) & WordChar);
+}
@@ -0,0 +1,58 @@
+/********************************************************************
+
+Name: Versatacts
+Homepage: http://github.com/ae5chylu5/versatacts
+Author: ae5chylu5
+Description: A versatile gui application capable of extracting and
+             converting contacts to/from a variety of popular
+             mobile formats.
+
+Copyright (C) 2016 ae5chylu5
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+********************************************************************/
+
+#ifndef FIELDCLASSIFIER_H
+#define FIELDCLASSIFIER_H
+
+#include "contactstore.h"
+
+#include <QChar>
+#include <QString>
+
+// FieldClassifier replaces the regular expressions that used to be
+// compiled for every field. the character classes of the ascii range
+// are looked up in a table built once per process; anything above it
+// falls back to the unicode properties qregexp used for \w and \d.
+//
+// the patterns it implements are:
+//   invalid chars   [^\w\.\+ \#\@\-\,\:\/]
+//   trim edges      ^[^\w\+\#]+|\W+$
+//   name            ^[A-Za-z_\- \.]+$
+//   phone           ^[\#\+]?\d{2,11}$
+//   email           @
+//   url             ://
+//   address         ^\d+ \w+
+class FieldClassifier
+{
+public:
+    static int sanitize(QChar *data, int length, int *start);
+    static ContactStore::FieldKind classify(const QChar *data, int length, bool allowLastName);
+    static bool isPhone(const QChar *data, int length);
+    static bool isPhone(const QString &value);
+    static bool isAddress(const QChar *data, int length);
+};
+
+#endif // FIELDCLASSIFIER_H
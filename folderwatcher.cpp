@@ -0,0 +1,341 @@
+/********************************************************************
+
+Name: Versatacts
+Homepage: http://github.com/ae5chylu5/versatacts
+Author: ae5chylu5
+Description: A versatile gui application capable of extracting and
+             converting contacts to/from a variety of popular
+             mobile formats.
+
+Copyright (C) 2016 ae5chylu5
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+********************************************************************/
+
+#include "folderwatcher.h"
+
+FolderWatcher::FolderWatcher(QObject *parent)
+    : QObject(parent), outputMode(AppendOutput), batchDone(0), rotation(1), isActive(false), isScanPending(false)
+{
+    debounceTimer.setSingleShot(true);
+    debounceTimer.setInterval(2000);
+    pollTimer.setInterval(10000);
+
+    connect(&fileWatcher, SIGNAL(directoryChanged(QString)), this, SLOT(scheduleScan()));
+    connect(&debounceTimer, SIGNAL(timeout()), this, SLOT(scan()));
+    connect(&pollTimer, SIGNAL(timeout()), this, SLOT(scan()));
+    connect(&batchWatcher, SIGNAL(finished()), this, SLOT(finishBatch()));
+    connect(&contactConverter, SIGNAL(warning(QString)), this, SIGNAL(warning(QString)));
+}
+
+FolderWatcher::~FolderWatcher()
+{
+    stop();
+}
+
+// starts watching path. files that were ingested into outputPath before
+// are skipped. the output has to be outside of the watched folder.
+bool FolderWatcher::start(const QString &path, const QString &outputPath, OutputMode mode)
+{
+    stop();
+    lastError.clear();
+
+    QDir dir(path);
+    if (!dir.exists()) {
+        lastError = tr("The watched folder cannot be found.");
+        return false;
+    }
+    if (QFileInfo(outputPath).absoluteDir() == dir) {
+        lastError = tr("The output has to be outside of the watched folder.");
+        return false;
+    }
+    if (!CompressedDevice::isSupported(CompressedDevice::formatForPath(outputPath))) {
+        lastError = tr("The compression format is not supported.");
+        return false;
+    }
+
+    folder = dir.absolutePath();
+    output = QFileInfo(outputPath).absoluteFilePath();
+    outputMode = mode;
+    if (!loadState()) ingestedFiles.clear();
+
+    if (mode == AppendOutput) {
+        outputFile.setFileName(output);
+        if (!outputFile.open(QIODevice::WriteOnly | QIODevice::Append)) {
+            lastError = tr("The output cannot be opened for writing.");
+            return false;
+        }
+    } else {
+        // rotated files are never overwritten
+        while (QFile::exists(ContactConverter::shardPath(output, rotation))) rotation++;
+    }
+
+    // network and some fuse file systems can't be watched
+    if (!fileWatcher.addPath(folder)) pollTimer.start();
+
+    isActive = true;
+    stopping.store(0);
+    QTimer::singleShot(0, this, SLOT(scan()));
+    return true;
+}
+
+// a batch that is being ingested is finished first
+void FolderWatcher::stop()
+{
+    if (!isActive) return;
+
+    isActive = false;
+    stopping.store(1);
+    debounceTimer.stop();
+    pollTimer.stop();
+    if (!fileWatcher.directories().isEmpty()) fileWatcher.removePaths(fileWatcher.directories());
+    batchWatcher.waitForFinished();
+    outputFile.close();
+}
+
+bool FolderWatcher::isWatching() const
+{
+    return isActive;
+}
+
+// true if the folder is polled because it can't be watched
+bool FolderWatcher::isPolling() const
+{
+    return pollTimer.isActive();
+}
+
+void FolderWatcher::setDebounceInterval(int msecs)
+{
+    debounceTimer.setInterval(msecs);
+}
+
+void FolderWatcher::setPollInterval(int msecs)
+{
+    pollTimer.setInterval(msecs);
+}
+
+// the converter parsing the files. it may only be set up while the
+// watcher is stopped.
+ContactConverter *FolderWatcher::converter()
+{
+    return &contactConverter;
+}
+
+QString FolderWatcher::errorString() const
+{
+    return lastError;
+}
+
+// contacts.vcf keeps its state in contacts.vcf.watch.json
+QString FolderWatcher::statePath(const QString &outputPath)
+{
+    return outputPath + ".watch.json";
+}
+
+// every change restarts the timer so a burst ends in a single scan
+void FolderWatcher::scheduleScan()
+{
+    if (isActive) debounceTimer.start();
+}
+
+void FolderWatcher::scan()
+{
+    if (!isActive) return;
+
+    // changes arriving during a batch are picked up after it
+    if (batchWatcher.isRunning()) {
+        isScanPending = true;
+        return;
+    }
+
+    // every file is listed, ingest() tells the formats by their content
+    QDir dir(folder);
+    const QFileInfoList entries = dir.entryInfoList(QDir::Files, QDir::Name);
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    bool isSettling = false;
+
+    batchFiles.clear();
+    for (int i=0; i<entries.count(); i++) {
+        const QFileInfo &fi = entries.at(i);
+        FileStamp stamp = {fi.size(), fi.lastModified().toMSecsSinceEpoch()};
+
+        QHash<QString, FileStamp>::const_iterator it = ingestedFiles.constFind(fi.fileName());
+        if (it != ingestedFiles.constEnd() && it->size == stamp.size && it->modified == stamp.modified) continue;
+
+        // a file changed a moment ago may still be written
+        if (now - stamp.modified < debounceTimer.interval()) {
+            isSettling = true;
+            continue;
+        }
+
+        batchFiles.append(fi.fileName());
+    }
+    if (isSettling) debounceTimer.start();
+    if (batchFiles.isEmpty()) return;
+
+    const QStringList files = batchFiles;
+    batchWatcher.setFuture(QtConcurrent::run([this, files]() {
+        return ingest(files);
+    }));
+}
+
+void FolderWatcher::finishBatch()
+{
+    int records = batchWatcher.result();
+
+    // a batch that couldn't be written is tried again with the next scan
+    if (records < 0) {
+        emit warning(output + tr(" cannot be written."));
+    } else {
+        // files that failed to parse are only tried again once they
+        // change. files a stopped batch didn't get to and files that were
+        // still being written are left for the next scan.
+        QStringList doneFiles;
+        bool isChanging = false;
+        for (int i=0; i<batchDone; i++) {
+            if (batchStamps.at(i).size < 0) {
+                isChanging = true;
+                continue;
+            }
+            ingestedFiles.insert(batchFiles.at(i), batchStamps.at(i));
+            doneFiles << batchFiles.at(i);
+        }
+        if (outputMode == RotateOutput && records > 0) rotation++;
+        if (!saveState()) emit warning(statePath(output) + tr(" cannot be written."));
+        emit ingested(doneFiles, records);
+
+        // the folder isn't told about changes to the content of a file
+        // so the files left out are looked at again once they settled
+        if (isChanging && isActive) debounceTimer.start();
+    }
+
+    if (isScanPending && isActive) {
+        isScanPending = false;
+        scan();
+    }
+}
+
+// runs on a worker thread. returns the number of records written or -1
+// if the output couldn't be written. an appended batch that fails is cut
+// off again so its files can be ingested once more without duplicates.
+// every file is stamped as it is parsed and one that changed meanwhile
+// is left out of the output and stamped with -1.
+int FolderWatcher::ingest(const QStringList &files)
+{
+    CompressedDevice::Format format = CompressedDevice::formatForPath(output);
+    QSaveFile rotated(ContactConverter::shardPath(output, rotation));
+    QFileDevice *file = &outputFile;
+    qint64 outputSize = outputFile.size();
+    if (outputMode == RotateOutput) {
+        if (!rotated.open(QIODevice::WriteOnly)) return -1;
+        file = &rotated;
+    }
+
+    FileStamp unfinished = {-1, -1};
+    batchStamps.fill(unfinished, files.count());
+    contactConverter.resetCancel();
+
+    // a compressed output gets a complete stream per batch
+    CompressedDevice deflater(file, format);
+    QIODevice *device = file;
+    if (format != CompressedDevice::Plain) {
+        if (!deflater.open(QIODevice::WriteOnly)) return -1;
+        device = &deflater;
+    }
+
+    int written = 0;
+    bool ok = true;
+    batchDone = 0;
+    for (int i=0; i<files.count() && ok && !stopping.load(); i++) {
+        batchDone++;
+        QString path = QDir(folder).filePath(files.at(i));
+        QFileInfo before(path);
+        FileStamp stamp = {before.size(), before.lastModified().toMSecsSinceEpoch()};
+
+        // files in no known format are passed over without a warning
+        FormatSniffer::Format type = FormatSniffer::formatForFile(path);
+        if (type == FormatSniffer::Unknown) {
+            batchStamps[i] = stamp;
+            continue;
+        }
+        if (!contactConverter.importFile(path, type)) {
+            emit warning(files.at(i) + ": " + contactConverter.errorString());
+            batchStamps[i] = stamp;
+            continue;
+        }
+
+        // a file that grew while it was parsed is taken with the next scan
+        QFileInfo after(path);
+        if (after.size() != stamp.size || after.lastModified().toMSecsSinceEpoch() != stamp.modified) continue;
+
+        ok = contactConverter.generateVCF(device);
+        written += contactConverter.records.count();
+        batchStamps[i] = stamp;
+    }
+    contactConverter.records.clear();
+
+    if (format != CompressedDevice::Plain) ok = deflater.finish() && ok;
+    if (outputMode == AppendOutput) {
+        ok = outputFile.flush() && ok;
+        if (!ok) outputFile.resize(outputSize);
+        return ok ? written : -1;
+    }
+
+    // an empty batch doesn't use up a file
+    if (!ok || written == 0) {
+        rotated.cancelWriting();
+        return ok ? 0 : -1;
+    }
+    return rotated.commit() ? written : -1;
+}
+
+bool FolderWatcher::loadState()
+{
+    ingestedFiles.clear();
+    QFile stateFile(statePath(output));
+    if (!stateFile.open(QIODevice::ReadOnly)) return false;
+
+    QJsonObject root = QJsonDocument::fromJson(stateFile.readAll()).object();
+    if (root.value("folder").toString() != folder) return false;
+
+    const QJsonArray files = root.value("files").toArray();
+    for (int i=0; i<files.count(); i++) {
+        QJsonObject entry = files.at(i).toObject();
+        FileStamp stamp = {qint64(entry.value("size").toDouble()), qint64(entry.value("modified").toDouble())};
+        ingestedFiles.insert(entry.value("name").toString(), stamp);
+    }
+    return true;
+}
+
+bool FolderWatcher::saveState()
+{
+    QJsonArray files;
+    for (QHash<QString, FileStamp>::const_iterator it = ingestedFiles.constBegin(); it != ingestedFiles.constEnd(); ++it) {
+        QJsonObject entry;
+        entry.insert("name", it.key());
+        entry.insert("size", double(it->size));
+        entry.insert("modified", double(it->modified));
+        files.append(entry);
+    }
+
+    QJsonObject root;
+    root.insert("folder", folder);
+    root.insert("files", files);
+
+    QSaveFile stateFile(statePath(output));
+    return stateFile.open(QIODevice::WriteOnly) &&
+           stateFile.write(QJsonDocument(root).toJson()) >= 0 &&
+           stateFile.commit();
+}
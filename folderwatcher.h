@@ -0,0 +1,129 @@
+/********************************************************************
+
+Name: Versatacts
+Homepage: http://github.com/ae5chylu5/versatacts
+Author: ae5chylu5
+Description: A versatile gui application capable of extracting and
+             converting contacts to/from a variety of popular
+             mobile formats.
+
+Copyright (C) 2016 ae5chylu5
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+********************************************************************/
+
+#ifndef FOLDERWATCHER_H
+#define FOLDERWATCHER_H
+
+#include "compresseddevice.h"
+#include "contactconverter.h"
+
+#include <QAtomicInt>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QFutureWatcher>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QObject>
+#include <QSaveFile>
+#include <QStringList>
+#include <QTimer>
+#include <QVector>
+#include <QtConcurrentRun>
+
+// FolderWatcher ingests the vcf, pbb, monosim and snapshot files arriving
+// in a drop folder, whatever their names. only files that are new or changed since they were last
+// ingested are parsed and their cards are written to the output, so the
+// work done is proportional to the new data.
+//
+// changes reported by QFileSystemWatcher are debounced so a burst of
+// files is handled in one batch and files modified within the debounce
+// interval are left until they settle. if the folder can't be watched
+// it is polled instead. the files already ingested are kept in a state
+// file next to the output so a restarted watch carries on where it
+// stopped.
+//
+// AppendOutput adds every batch to the end of a single vcf. compressed
+// outputs get one gzip member or zstd frame per batch. RotateOutput
+// writes each batch to the next numbered file (see shardPath()), which
+// only appears once complete. a batch that fails is taken back out of the
+// output and tried again with the next scan. a changed file is ingested
+// again in full, the cards written for it before stay in the output.
+class FolderWatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum OutputMode {
+        AppendOutput,
+        RotateOutput
+    };
+
+    FolderWatcher(QObject *parent = 0);
+    ~FolderWatcher();
+    bool start(const QString &folder, const QString &outputPath, OutputMode mode = AppendOutput);
+    void stop();
+    bool isWatching() const;
+    bool isPolling() const;
+    void setDebounceInterval(int msecs);
+    void setPollInterval(int msecs);
+    ContactConverter *converter();
+    QString errorString() const;
+    static QString statePath(const QString &outputPath);
+
+signals:
+    void ingested(const QStringList &files, int records);
+    void warning(const QString &message);
+
+private slots:
+    void scheduleScan();
+    void scan();
+    void finishBatch();
+
+private:
+    struct FileStamp {
+        qint64 size;
+        qint64 modified;
+    };
+
+    int ingest(const QStringList &files);
+    bool loadState();
+    bool saveState();
+    ContactConverter contactConverter;
+    QFileSystemWatcher fileWatcher;
+    QTimer debounceTimer;
+    QTimer pollTimer;
+    QFutureWatcher<int> batchWatcher;
+    QString folder;
+    QString output;
+    QString lastError;
+    OutputMode outputMode;
+    QFile outputFile; // open while appending
+    QHash<QString, FileStamp> ingestedFiles;
+    QStringList batchFiles;
+    QVector<FileStamp> batchStamps; // taken as each file is parsed, -1 if left out
+    int batchDone; // files of the batch that were handled
+    int rotation; // number of the next rotated file
+    bool isActive;
+    bool isScanPending;
+    QAtomicInt stopping; // read by the batch on the worker thread
+};
+
+#endif // FOLDERWATCHER_H
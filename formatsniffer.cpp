@@ -0,0 +1,189 @@
+/********************************************************************
+
+Name: Versatacts
+Homepage: http://github.com/ae5chylu5/versatacts
+Author: ae5chylu5
+Description: A versatile gui application capable of extracting and
+             converting contacts to/from a variety of popular
+             mobile formats.
+
+Copyright (C) 2016 ae5chylu5
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+********************************************************************/
+
+#include "formatsniffer.h"
+
+// the best guess for the head of a file. isComplete tells if the head
+// is the whole file.
+FormatSniffer::Result FormatSniffer::sniff(const char *data, qint64 size, bool isComplete)
+{
+    Result result = {Unknown, 0};
+
+    if (ContactSnapshot::isSnapshot(data, size)) {
+        result.format = Snapshot;
+        result.confidence = 100;
+        return result;
+    }
+
+    // the text formats are looked at in the encoding the decoders will use
+    int bomLength;
+    TextDecoder::Encoding encoding = TextDecoder::detect(data, size, &bomLength);
+    QString text = TextDecoder::decode(data + bomLength, size - bomLength, encoding);
+
+    const Format formats[] = {Vcf, Pbb, Monosim};
+    const int confidences[] = {vcfConfidence(text), pbbConfidence(data, size), monosimConfidence(text, isComplete)};
+    for (int i=0; i<3; i++) {
+        if (confidences[i] <= result.confidence) continue;
+        result.format = formats[i];
+        result.confidence = confidences[i];
+    }
+    return result;
+}
+
+// reads the head of the file at path, inflating it if the name says it
+// is compressed
+FormatSniffer::Result FormatSniffer::sniffFile(const QString &path)
+{
+    Result result = {Unknown, 0};
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return result;
+
+    QByteArray head;
+    CompressedDevice::Format compression = CompressedDevice::formatForPath(path);
+    if (compression == CompressedDevice::Plain) {
+        head = file.read(headSize);
+    } else {
+        CompressedDevice inflater(&file, compression);
+        if (!inflater.open(QIODevice::ReadOnly)) return result;
+        head = inflater.read(headSize);
+        if (inflater.hasError()) return result;
+    }
+
+    return sniff(head.constData(), head.size(), head.size() < headSize);
+}
+
+// the format the file at path is decoded as. the content decides unless
+// it is too short or too unusual to tell, then the name does.
+FormatSniffer::Format FormatSniffer::formatForFile(const QString &path)
+{
+    Result sniffed = sniffFile(path);
+    if (sniffed.confidence >= minimumConfidence) return sniffed.format;
+    return formatForSuffix(CompressedDevice::suffix(path));
+}
+
+FormatSniffer::Format FormatSniffer::formatForSuffix(const QString &suffix)
+{
+    if (suffix == "pbb") return Pbb;
+    if (suffix == "monosim") return Monosim;
+    if (suffix == "vcf") return Vcf;
+    if (suffix == "vcsnap") return Snapshot;
+    return Unknown;
+}
+
+// a pbb file is split into lines by runs of two or more 00 bytes, see
+// PbbDecoder. the values are text and the records are separated by
+// lines of less than 4 bytes starting with the record index.
+int FormatSniffer::pbbConfidence(const char *data, qint64 size)
+{
+    const uchar *bytes = reinterpret_cast<const uchar *>(data);
+    qint64 valueBytes = 0;
+    qint64 printable = 0;
+    int lines = 0;
+    int separators = 0;
+    int lineLength = 0;
+    uchar first = 0;
+    bool isHeader = true; // the first line is junk ending in the record count
+    qint64 i = 0;
+    qint64 run;
+
+    while (i < size) {
+        for (run=0; i < size && bytes[i] == 0; i++) run++;
+
+        // a single 00 continues the line
+        if (run >= 2 && lineLength > 0) {
+            if (!isHeader) {
+                lines++;
+                if (lineLength < 4 && first > 0 && first < 0x20) separators++;
+            }
+            isHeader = false;
+            lineLength = 0;
+        }
+
+        for (; i < size && bytes[i] != 0; i++) {
+            if (lineLength == 0) first = bytes[i];
+            lineLength++;
+            valueBytes++;
+            if (bytes[i] >= 0x20 || bytes[i] == '\t') printable++;
+        }
+    }
+
+    if (lines == 0) return 0;
+
+    // binary data other than pbb rarely looks like text
+    if (printable * 10 < valueBytes * 8) return 10;
+    return separators > 0 ? 90 : 40;
+}
+
+// a card at the very start is certain. text in front of it, e.g. a mail
+// header, still leaves a line starting with BEGIN:VCARD.
+int FormatSniffer::vcfConfidence(const QString &text)
+{
+    int pos = text.indexOf(QLatin1String("BEGIN:VCARD"), 0, Qt::CaseInsensitive);
+    if (pos < 0) return 0;
+
+    int i = 0;
+    while (i < pos && text.at(i).isSpace()) i++;
+    if (i == pos) return 100;
+    return text.at(pos - 1) == QLatin1Char('\n') ? 80 : 20;
+}
+
+// a monosim file holds one name per line followed by a line with the
+// phone number. a name may be split over several lines.
+int FormatSniffer::monosimConfidence(const QString &text, bool isComplete)
+{
+    QStringList lines = text.split(QLatin1Char('\n'));
+
+    // the last line may be cut off by the end of the head
+    if (!isComplete) lines.removeLast();
+
+    int count = 0;
+    int pairs = 0;
+    bool isAfterName = false;
+    for (int i=0; i<lines.count(); i++) {
+        QString line = lines.at(i).trimmed();
+        if (line.isEmpty()) continue;
+
+        // control characters only show up in binary data
+        for (int j=0; j<line.length(); j++) {
+            if (line.at(j).unicode() < 0x20 && line.at(j) != QLatin1Char('\t')) return 0;
+        }
+
+        count++;
+        if (FieldClassifier::isPhone(line)) {
+            if (isAfterName) pairs++;
+            isAfterName = false;
+        } else {
+            isAfterName = true;
+        }
+    }
+
+    if (count < 2 || pairs == 0) return 0;
+
+    // a clean file alternates between names and numbers. a couple of
+    // lines could be anything.
+    int confidence = pairs * 2 * 90 / count;
+    return count < 4 ? qMin(confidence, 60) : qMin(confidence, 90);
+}
@@ -0,0 +1,84 @@
+/********************************************************************
+
+Name: Versatacts
+Homepage: http://github.com/ae5chylu5/versatacts
+Author: ae5chylu5
+Description: A versatile gui application capable of extracting and
+             converting contacts to/from a variety of popular
+             mobile formats.
+
+Copyright (C) 2016 ae5chylu5
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+********************************************************************/
+
+#ifndef FORMATSNIFFER_H
+#define FORMATSNIFFER_H
+
+#include "compresseddevice.h"
+#include "contactsnapshot.h"
+#include "fieldclassifier.h"
+#include "textdecoder.h"
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+#include <QStringList>
+
+// FormatSniffer tells the input formats apart by the first few kilobytes
+// of a file so renamed or extensionless files reach the right decoder.
+// compressed files are inflated just far enough to fill the head.
+//
+// the formats are recognized by
+//   snapshot   the magic number of ContactSnapshot
+//   vcf        a BEGIN:VCARD line, best at the very start
+//   pbb        values split by runs of 00 bytes and short record
+//              separator lines such as 01 01 02
+//   monosim    text lines where a phone number follows one or more
+//              name lines
+//
+// every format gets a confidence from 0 to 100 and the best one wins.
+// below minimumConfidence formatForFile() goes by the file name instead.
+class FormatSniffer
+{
+public:
+    enum Format {
+        Unknown,
+        Pbb,
+        Monosim,
+        Vcf,
+        Snapshot
+    };
+
+    struct Result {
+        Format format;
+        int confidence;
+    };
+
+    static const int headSize = 4096; // bytes looked at
+    static const int minimumConfidence = 50;
+
+    static Result sniff(const char *data, qint64 size, bool isComplete);
+    static Result sniffFile(const QString &path);
+    static Format formatForFile(const QString &path);
+    static Format formatForSuffix(const QString &suffix);
+
+private:
+    static int pbbConfidence(const char *data, qint64 size);
+    static int vcfConfidence(const QString &text);
+    static int monosimConfidence(const QString &text, bool isComplete);
+};
+
+#endif // FORMATSNIFFER_H
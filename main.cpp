@@ -30,6 +30,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
+    QCoreApplication::setOrganizationName("ae5chylu5");
+    QCoreApplication::setApplicationName("versatacts");
     Versatacts w;
     w.show();
 
@@ -0,0 +1,130 @@
+/********************************************************************
+
+Name: Versatacts
+Homepage: http://github.com/ae5chylu5/versatacts
+Author: ae5chylu5
+Description: A versatile gui application capable of extracting and
+             converting contacts to/from a variety of popular
+             mobile formats.
+
+Copyright (C) 2016 ae5chylu5
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+********************************************************************/
+
+#ifndef MAPPEDVECTOR_H
+#define MAPPEDVECTOR_H
+
+#include <QVector>
+
+#include <algorithm>
+
+// MappedVector is a QVector that can also stand in for an array it
+// doesn't own, such as a table in a memory mapped file. reads go
+// straight to the array and the first change copies it into the vector,
+// the same way a QString made by fromRawData() behaves. the array must
+// outlive every read.
+template <typename T>
+class MappedVector
+{
+public:
+    MappedVector() : raw(0), rawCount(0)
+    {
+
+    }
+
+    static MappedVector fromRawData(const T *data, int count)
+    {
+        MappedVector vector;
+        vector.raw = data;
+        vector.rawCount = count;
+        return vector;
+    }
+
+    int count() const
+    {
+        return raw ? rawCount : items.count();
+    }
+
+    bool isEmpty() const
+    {
+        return count() == 0;
+    }
+
+    const T &at(int i) const
+    {
+        return raw ? raw[i] : items.at(i);
+    }
+
+    T &operator[](int i)
+    {
+        detach();
+        return items[i];
+    }
+
+    T *data()
+    {
+        detach();
+        return items.data();
+    }
+
+    void append(const T &item)
+    {
+        detach();
+        items.append(item);
+    }
+
+    void insert(int i, const T &item)
+    {
+        detach();
+        items.insert(i, item);
+    }
+
+    void resize(int size)
+    {
+        detach();
+        items.resize(size);
+    }
+
+    void reserve(int size)
+    {
+        detach();
+        items.reserve(size);
+    }
+
+    void clear()
+    {
+        raw = 0;
+        rawCount = 0;
+        items.clear();
+    }
+
+private:
+    // copies the array into the vector before it is changed
+    void detach()
+    {
+        if (!raw) return;
+        items.resize(rawCount);
+        std::copy(raw, raw + rawCount, items.begin());
+        raw = 0;
+        rawCount = 0;
+    }
+
+    QVector<T> items;
+    const T *raw;
+    int rawCount;
+};
+
+#endif // MAPPEDVECTOR_H
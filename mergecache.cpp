@@ -0,0 +1,143 @@
+/********************************************************************
+
+Name: Versatacts
+Homepage: http://github.com/ae5chylu5/versatacts
+Author: ae5chylu5
+Description: A versatile gui application capable of extracting and
+             converting contacts to/from a variety of popular
+             mobile formats.
+
+Copyright (C) 2016 ae5chylu5
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+********************************************************************/
+
+#include "mergecache.h"
+
+MergeCache::MergeCache()
+{
+    saveFile = 0;
+}
+
+MergeCache::~MergeCache()
+{
+    // an uncommitted save file is discarded along with it
+    delete saveFile;
+    QHash<QString, Entry>::iterator it;
+    for (it = entries.begin(); it != entries.end(); ++it) delete it.value().store;
+}
+
+// every folder gets its own cache file named after its absolute path.
+// options that change the parsed records pass a variant so each setting
+// keeps a cache of its own.
+QString MergeCache::cachePath(const QString &cacheDir, const QString &folder, const QString &variant)
+{
+    QByteArray key = QCryptographicHash::hash(QDir(folder).absolutePath().toUtf8(), QCryptographicHash::Sha1);
+    QString name = "merge-" + QString::fromLatin1(key.toHex());
+    if (!variant.isEmpty()) name.append("-" + variant);
+    return QDir(cacheDir).filePath(name + ".cache");
+}
+
+QByteArray MergeCache::fileHash(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return QByteArray();
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(&file);
+    return hash.result();
+}
+
+// a missing or unreadable cache is not an error, every file is simply
+// parsed again
+bool MergeCache::load(const QString &path)
+{
+    QFile cacheFile(path);
+    if (!cacheFile.open(QIODevice::ReadOnly)) return false;
+
+    QDataStream inStream(&cacheFile);
+    quint32 fileMagic,fileVersion;
+    inStream >> fileMagic >> fileVersion;
+    if (fileMagic != magic || fileVersion != version) return false;
+    inStream.setVersion(QDataStream::Qt_5_0);
+
+    quint8 hasEntry;
+    QString name;
+    Entry entry;
+    while (true) {
+        inStream >> hasEntry;
+        if (inStream.status() != QDataStream::Ok || !hasEntry) break;
+
+        entry.store = new ContactStore;
+        inStream >> name >> entry.size >> entry.modified >> entry.hash >> *entry.store;
+        if (inStream.status() != QDataStream::Ok) {
+            delete entry.store;
+            break;
+        }
+        entries.insert(name, entry);
+    }
+
+    return inStream.status() == QDataStream::Ok;
+}
+
+// returns the cached records of a file if it hasn't changed. the caller
+// takes ownership of the store.
+ContactStore *MergeCache::take(const QString &name, qint64 size, qint64 modified, const QByteArray &hash)
+{
+    QHash<QString, Entry>::iterator it = entries.find(name);
+    if (it == entries.end()) return 0;
+
+    Entry entry = it.value();
+    if (entry.size != size || entry.modified != modified || entry.hash != hash) return 0;
+
+    entries.erase(it);
+    return entry.store;
+}
+
+bool MergeCache::beginWrite(const QString &path)
+{
+    QDir().mkpath(QFileInfo(path).absolutePath());
+
+    delete saveFile;
+    saveFile = new QSaveFile(path);
+    if (!saveFile->open(QIODevice::WriteOnly)) {
+        delete saveFile;
+        saveFile = 0;
+        return false;
+    }
+
+    outStream.setDevice(saveFile);
+    outStream << magic << version;
+    outStream.setVersion(QDataStream::Qt_5_0);
+    return true;
+}
+
+void MergeCache::write(const QString &name, qint64 size, qint64 modified, const QByteArray &hash, const ContactStore &store)
+{
+    if (!saveFile) return;
+    outStream << quint8(1) << name << size << modified << hash << store;
+}
+
+bool MergeCache::commit()
+{
+    if (!saveFile) return false;
+
+    outStream << quint8(0);
+    bool ok = outStream.status() == QDataStream::Ok && saveFile->commit();
+    outStream.setDevice(0);
+    delete saveFile;
+    saveFile = 0;
+    return ok;
+}
@@ -0,0 +1,78 @@
+/********************************************************************
+
+Name: Versatacts
+Homepage: http://github.com/ae5chylu5/versatacts
+Author: ae5chylu5
+Description: A versatile gui application capable of extracting and
+             converting contacts to/from a variety of popular
+             mobile formats.
+
+Copyright (C) 2016 ae5chylu5
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+********************************************************************/
+
+#ifndef MERGECACHE_H
+#define MERGECACHE_H
+
+#include "contactstore.h"
+
+#include <QByteArray>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QSaveFile>
+#include <QString>
+
+// MergeCache remembers the records parsed from every file of a merged
+// folder. entries are keyed by file name, size and modification time and
+// optionally a hash of the contents. a re-merge takes the entries that
+// still match and only parses new or changed files.
+//
+// the new cache is written while merging, in folder order, and replaces
+// the old one on commit() so files that were deleted drop out of it.
+class MergeCache
+{
+public:
+    MergeCache();
+    ~MergeCache();
+    static QString cachePath(const QString &cacheDir, const QString &folder, const QString &variant = QString());
+    static QByteArray fileHash(const QString &path);
+    bool load(const QString &path);
+    ContactStore *take(const QString &name, qint64 size, qint64 modified, const QByteArray &hash);
+    bool beginWrite(const QString &path);
+    void write(const QString &name, qint64 size, qint64 modified, const QByteArray &hash, const ContactStore &store);
+    bool commit();
+
+private:
+    struct Entry {
+        qint64 size;
+        qint64 modified;
+        QByteArray hash;
+        ContactStore *store;
+    };
+
+    static const quint32 magic = 0x56434d43; // VCMC
+    static const quint32 version = 4; // 4: file encoding detection
+
+    QHash<QString, Entry> entries;
+    QSaveFile *saveFile;
+    QDataStream outStream;
+};
+
+#endif // MERGECACHE_H
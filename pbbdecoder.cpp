@@ -0,0 +1,155 @@
+/********************************************************************
+
+Name: Versatacts
+Homepage: http://github.com/ae5chylu5/versatacts
+Author: ae5chylu5
+Description: A versatile gui application capable of extracting and
+             converting contacts to/from a variety of popular
+             mobile formats.
+
+Copyright (C) 2016 ae5chylu5
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+********************************************************************/
+
+#include "pbbdecoder.h"
+
+#include <cstring>
+
+PbbDecoder::PbbDecoder(const char *data, qint64 size)
+    : data(data), dataSize(size), pos(0), isFinal(true), blanks(0), total(-1), recordIndex(1), totalRead(0)
+{
+
+}
+
+// continues with the next chunk of the file. the previous chunk is no
+// longer used.
+void PbbDecoder::setData(const char *data, qint64 size, bool isFinal)
+{
+    this->data = data;
+    dataSize = size;
+    pos = 0;
+    this->isFinal = isFinal;
+}
+
+qint64 PbbDecoder::position() const
+{
+    return pos;
+}
+
+qint64 PbbDecoder::size() const
+{
+    return dataSize;
+}
+
+int PbbDecoder::totalRecords() const
+{
+    return total;
+}
+
+int PbbDecoder::recordsRead() const
+{
+    return totalRead;
+}
+
+bool PbbDecoder::readRecord(QStringList &record)
+{
+    QStringList name;
+    bool isComplete = false;
+
+    record.clear();
+
+    while (pos < dataSize && !isComplete) {
+        // skip the run of 00 characters in front of the next value. after
+        // 2 consecutive blank characters the next value starts a new line.
+        // the run may have started at the end of the previous chunk.
+        while (pos < dataSize && data[pos] == 0) {
+            if (blanks < 2) blanks++;
+            pos++;
+        }
+        if (pos >= dataSize) break;
+
+        // everything up to the next 00 belongs to the same line
+        const char *end = static_cast<const char *>(memchr(data + pos, 0, dataSize - pos));
+        qint64 runEnd = end ? end - data : dataSize;
+
+        if (blanks == 2) {
+            if (total < 0 && totalRead == 0 && pending.isEmpty()) {
+                // we need the last character of the first line which tells
+                // us how many records the pbb contains. the rest of line 1
+                // is junk.
+                total = line.isEmpty() ? 0 : static_cast<uchar>(line.at(line.size() - 1));
+                line.clear();
+            } else if (!line.isEmpty() && line.size() < 4 &&
+                       static_cast<uchar>(line.at(0)) == recordIndex &&
+                       (recordIndex > 2 || line.size() > 1)) {
+                // the current line is a database record separator
+                name.clear();
+                for (int i=0; i<2; i++) {
+                    if (pending.isEmpty()) break;
+
+                    // make sure last line is not email, phone or url. we're trying to
+                    // retrieve first and last name here from end of previous record.
+                    if (pending.last().contains("@") ||
+                        pending.last().contains("://") ||
+                        FieldClassifier::isPhone(pending.last())) break;
+
+                    name << pending.last();
+                    pending.pop_back();
+                }
+
+                // if record contains values hand it back. time to move on to new record.
+                if (!pending.isEmpty()) {
+                    record = pending;
+                    pending.clear();
+                    totalRead++;
+                    isComplete = true;
+                }
+
+                // if we found a name above then save it to new record
+                if (!name.isEmpty()) pending << name;
+
+                line.clear();
+                if (totalRead > 0) recordIndex++; // ready for next record
+            } else if (!line.isEmpty()) {
+                // save line to current record
+                pending << TextDecoder::decode(line.constData(), line.size(), TextDecoder::Utf8);
+                line.clear();
+            }
+        }
+
+        // a single 00 is dropped so the value continues the current line
+        line.append(data + pos, runEnd - pos);
+        pos = runEnd;
+        blanks = 0;
+    }
+
+    if (isComplete) return true;
+
+    // the rest of the record is in the next chunk
+    if (!isFinal) return false;
+
+    // grab final line and record of the file since no separator follows them
+    if (!line.isEmpty()) {
+        pending << TextDecoder::decode(line.constData(), line.size(), TextDecoder::Utf8);
+        line.clear();
+    }
+    if (pending.isEmpty()) return false;
+
+    record = pending;
+    pending.clear();
+    totalRead++;
+    return true;
+}
@@ -0,0 +1,71 @@
+/********************************************************************
+
+Name: Versatacts
+Homepage: http://github.com/ae5chylu5/versatacts
+Author: ae5chylu5
+Description: A versatile gui application capable of extracting and
+             converting contacts to/from a variety of popular
+             mobile formats.
+
+Copyright (C) 2016 ae5chylu5
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+********************************************************************/
+
+#ifndef PBBDECODER_H
+#define PBBDECODER_H
+
+#include "fieldclassifier.h"
+#include "textdecoder.h"
+
+#include <QByteArray>
+#include <QStringList>
+
+// PbbDecoder walks the raw bytes of a pbb file in a single pass and
+// hands back one record at a time. the buffer is usually a memory
+// mapped file so the decoder never copies more than the current line.
+//
+// a pbb file is a sequence of null padded values. a single 00 byte is
+// ignored while two or more split the values into lines. lines such as
+// 010102, 020102, 030102 separate the database records.
+//
+// a file that isn't in memory in one piece, e.g. a compressed one, is
+// handed over in chunks with setData(). the decoder keeps its state
+// between them and only hands back the last record with the final one.
+class PbbDecoder
+{
+public:
+    PbbDecoder(const char *data = 0, qint64 size = 0);
+    void setData(const char *data, qint64 size, bool isFinal = true);
+    bool readRecord(QStringList &record);
+    qint64 position() const;
+    qint64 size() const;
+    int totalRecords() const;
+    int recordsRead() const;
+
+private:
+    const char *data;
+    qint64 dataSize;
+    qint64 pos;
+    bool isFinal; // no data follows the current buffer
+    int blanks; // 00 bytes in front of the next value
+    int total; // total number of contacts as displayed in input file
+    int recordIndex; // index of current record - starts at 0 but we start at 1 since there's no easy way to detect record 0
+    int totalRead;
+    QByteArray line;
+    QStringList pending;
+};
+
+#endif // PBBDECODER_H
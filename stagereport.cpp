@@ -0,0 +1,118 @@
+/********************************************************************
+
+Name: Versatacts
+Homepage: http://github.com/ae5chylu5/versatacts
+Author: ae5chylu5
+Description: A versatile gui application capable of extracting and
+             converting contacts to/from a variety of popular
+             mobile formats.
+
+Copyright (C) 2016 ae5chylu5
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+********************************************************************/
+
+#include "stagereport.h"
+
+// the clock starts with the stage
+StageReport::Stage::Stage(const QString &name, const QString &input)
+    : name(name), input(input), nsecs(-1)
+{
+    timer.start();
+}
+
+// counters keep the order they were first set in
+void StageReport::Stage::count(const char *counter, qint64 value)
+{
+    for (int i=0; i<counters.count(); i++) {
+        if (qstrcmp(counters.at(i).first, counter) == 0) {
+            counters[i].second = value;
+            return;
+        }
+    }
+    counters.append(qMakePair(counter, value));
+}
+
+void StageReport::Stage::finish()
+{
+    nsecs = timer.nsecsElapsed();
+}
+
+// bytes and records are turned into rates as well
+QJsonObject StageReport::Stage::toJson() const
+{
+    QJsonObject object;
+    double seconds = (nsecs < 0 ? timer.nsecsElapsed() : nsecs) / 1e9;
+
+    object.insert("stage", name);
+    if (!input.isEmpty()) object.insert("input", input);
+    object.insert("wallMs", seconds * 1e3);
+    for (int i=0; i<counters.count(); i++) {
+        const char *counter = counters.at(i).first;
+        qint64 value = counters.at(i).second;
+        object.insert(QLatin1String(counter), double(value));
+        if (seconds <= 0) continue;
+        if (qstrcmp(counter, "bytes") == 0) object.insert("mbPerSec", value / seconds / (1024.0 * 1024.0));
+        if (qstrcmp(counter, "records") == 0) object.insert("recordsPerSec", value / seconds);
+    }
+    return object;
+}
+
+StageReport::StageReport()
+{
+
+}
+
+void StageReport::add(const Stage &stage)
+{
+    QMutexLocker locker(&mutex);
+    stages.append(stage);
+    stages.last().finish();
+}
+
+void StageReport::clear()
+{
+    QMutexLocker locker(&mutex);
+    stages.clear();
+}
+
+int StageReport::count() const
+{
+    QMutexLocker locker(&mutex);
+    return stages.count();
+}
+
+QByteArray StageReport::toJson() const
+{
+    QJsonArray list;
+    QMutexLocker locker(&mutex);
+    for (int i=0; i<stages.count(); i++) list.append(stages.at(i).toJson());
+    locker.unlock();
+
+    QJsonObject root;
+    root.insert("application", QCoreApplication::applicationName());
+    root.insert("version", QCoreApplication::applicationVersion());
+    root.insert("created", QDateTime::currentDateTimeUtc().toString(Qt::ISODate));
+    root.insert("stages", list);
+    return QJsonDocument(root).toJson();
+}
+
+bool StageReport::save(const QString &path) const
+{
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) return false;
+    file.write(toJson());
+    return file.commit();
+}
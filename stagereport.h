@@ -0,0 +1,78 @@
+/********************************************************************
+
+Name: Versatacts
+Homepage: http://github.com/ae5chylu5/versatacts
+Author: ae5chylu5
+Description: A versatile gui application capable of extracting and
+             converting contacts to/from a variety of popular
+             mobile formats.
+
+Copyright (C) 2016 ae5chylu5
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+********************************************************************/
+
+#ifndef STAGEREPORT_H
+#define STAGEREPORT_H
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QList>
+#include <QMutex>
+#include <QPair>
+#include <QSaveFile>
+#include <QString>
+#include <QVector>
+
+// StageReport collects the wall time and counters of every stage the
+// converter runs, e.g. bytes read, records produced or classifier calls.
+// the stages can be written as json to compare the throughput of inputs
+// and machines. stages may be added from any thread.
+class StageReport
+{
+public:
+    class Stage
+    {
+    public:
+        Stage(const QString &name, const QString &input = QString());
+        void count(const char *counter, qint64 value);
+        void finish();
+        QJsonObject toJson() const;
+
+    private:
+        QString name;
+        QString input;
+        QElapsedTimer timer;
+        qint64 nsecs;
+        QVector<QPair<const char *, qint64> > counters;
+    };
+
+    StageReport();
+    void add(const Stage &stage);
+    void clear();
+    int count() const;
+    QByteArray toJson() const;
+    bool save(const QString &path) const;
+
+private:
+    mutable QMutex mutex;
+    QList<Stage> stages;
+};
+
+#endif // STAGEREPORT_H
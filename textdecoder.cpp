@@ -0,0 +1,221 @@
+/********************************************************************
+
+Name: Versatacts
+Homepage: http://github.com/ae5chylu5/versatacts
+Author: ae5chylu5
+Description: A versatile gui application capable of extracting and
+             converting contacts to/from a variety of popular
+             mobile formats.
+
+Copyright (C) 2016 ae5chylu5
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+********************************************************************/
+
+#include "textdecoder.h"
+
+static const quint64 highBits = Q_UINT64_C(0x8080808080808080);
+
+TextDecoder::TextDecoder(const char *data, qint64 size)
+    : data(data), dataSize(size), isFinal(true), isDetected(size > 0)
+{
+    int bomLength;
+    textEncoding = detect(data, size, &bomLength);
+    pos = bomLength;
+}
+
+// continues with the next chunk of the file. the encoding and byte order
+// mark are only looked for in the first chunk that isn't empty.
+void TextDecoder::setData(const char *data, qint64 size, bool isFinal)
+{
+    this->data = data;
+    dataSize = size;
+    pos = 0;
+    this->isFinal = isFinal;
+    if (isDetected || size == 0) return;
+
+    int bomLength;
+    textEncoding = detect(data, size, &bomLength, !isFinal);
+    pos = bomLength;
+    isDetected = true;
+}
+
+// hands back the next line without its line break. returns false at
+// the end of the buffer, or in front of an unfinished line if more data
+// follows.
+bool TextDecoder::readLine(QString &line)
+{
+    if (pos >= dataSize) return false;
+
+    qint64 start = pos;
+    qint64 end;
+
+    if (textEncoding == Utf16LE || textEncoding == Utf16BE) {
+        // a newline is 0a 00 or 00 0a depending on the byte order
+        int low = textEncoding == Utf16LE ? 0 : 1;
+        end = start;
+        while (end + 1 < dataSize && !(data[end + low] == '\n' && data[end + 1 - low] == 0)) end += 2;
+        if (end + 1 >= dataSize) {
+            // the rest of the line is in the next chunk
+            if (!isFinal) return false;
+            end = dataSize & ~qint64(1);
+        }
+        pos = end + 2;
+        if (end - start >= 2 && data[end - 2 + low] == '\r' && data[end - 1 - low] == 0) end -= 2;
+    } else {
+        const char *newline = static_cast<const char *>(memchr(data + start, '\n', dataSize - start));
+        if (!newline && !isFinal) return false;
+        end = newline ? newline - data : dataSize;
+        pos = end + 1;
+        if (end > start && data[end - 1] == '\r') end--;
+    }
+
+    line = decode(data + start, end - start, textEncoding);
+    return true;
+}
+
+TextDecoder::Encoding TextDecoder::encoding() const
+{
+    return textEncoding;
+}
+
+qint64 TextDecoder::position() const
+{
+    return qMin(pos, dataSize);
+}
+
+qint64 TextDecoder::size() const
+{
+    return dataSize;
+}
+
+// bomLength is set to the number of bytes the byte order mark takes up.
+// isPartial means more of the text follows data.
+TextDecoder::Encoding TextDecoder::detect(const char *data, qint64 size, int *bomLength, bool isPartial)
+{
+    const uchar *bytes = reinterpret_cast<const uchar *>(data);
+    *bomLength = 0;
+
+    if (size >= 3 && bytes[0] == 0xef && bytes[1] == 0xbb && bytes[2] == 0xbf) {
+        *bomLength = 3;
+        return Utf8;
+    }
+    if (size >= 2 && bytes[0] == 0xff && bytes[1] == 0xfe) {
+        *bomLength = 2;
+        return Utf16LE;
+    }
+    if (size >= 2 && bytes[0] == 0xfe && bytes[1] == 0xff) {
+        *bomLength = 2;
+        return Utf16BE;
+    }
+
+    // latin text in utf-16 has a zero in every other byte
+    qint64 sample = qMin(size, qint64(sampleSize)) & ~qint64(1);
+    int evenZeros = 0;
+    int oddZeros = 0;
+    for (qint64 i=0; i<sample; i+=2) {
+        if (bytes[i] == 0) evenZeros++;
+        if (bytes[i + 1] == 0) oddZeros++;
+    }
+    if (sample > 0 && oddZeros * 4 > sample / 2 && oddZeros > evenZeros * 4) return Utf16LE;
+    if (sample > 0 && evenZeros * 4 > sample / 2 && evenZeros > oddZeros * 4) return Utf16BE;
+
+    return isUtf8(data, size, isPartial) ? Utf8 : Latin1;
+}
+
+// the number of leading bytes below 0x80
+qint64 TextDecoder::asciiPrefix(const char *data, qint64 size)
+{
+    qint64 i = 0;
+    quint64 word;
+    while (i + 8 <= size) {
+        memcpy(&word, data + i, 8);
+        if (word & highBits) break;
+        i += 8;
+    }
+    while (i < size && uchar(data[i]) < 0x80) i++;
+    return i;
+}
+
+// strict utf-8, overlong forms and surrogates are rejected. if isPartial
+// is set the text goes on after data and a sequence cut off at the end is
+// only checked as far as it goes.
+bool TextDecoder::isUtf8(const char *data, qint64 size, bool isPartial)
+{
+    const uchar *bytes = reinterpret_cast<const uchar *>(data);
+    qint64 i = 0;
+
+    while (i < size) {
+        i += asciiPrefix(data + i, size - i);
+        if (i >= size) break;
+
+        uchar c = bytes[i];
+        int count;
+        quint32 codePoint;
+        if (c >= 0xc2 && c <= 0xdf) {
+            count = 1;
+            codePoint = c & 0x1f;
+        } else if ((c & 0xf0) == 0xe0) {
+            count = 2;
+            codePoint = c & 0x0f;
+        } else if (c >= 0xf0 && c <= 0xf4) {
+            count = 3;
+            codePoint = c & 0x07;
+        } else {
+            return false;
+        }
+        if (i + count >= size) {
+            if (!isPartial) return false;
+            for (qint64 k=i+1; k<size; k++) {
+                if ((bytes[k] & 0xc0) != 0x80) return false;
+            }
+            return true;
+        }
+
+        for (int k=1; k<=count; k++) {
+            if ((bytes[i + k] & 0xc0) != 0x80) return false;
+            codePoint = codePoint << 6 | (bytes[i + k] & 0x3f);
+        }
+        if (count == 2 && (codePoint < 0x800 || (codePoint >= 0xd800 && codePoint <= 0xdfff))) return false;
+        if (count == 3 && (codePoint < 0x10000 || codePoint > 0x10ffff)) return false;
+        i += count + 1;
+    }
+    return true;
+}
+
+QString TextDecoder::decode(const char *data, qint64 size, Encoding encoding)
+{
+    switch (encoding) {
+    case Latin1:
+        return QString::fromLatin1(data, int(size));
+    case Utf16LE:
+    case Utf16BE: {
+        QString text(int(size / 2), Qt::Uninitialized);
+        const uchar *bytes = reinterpret_cast<const uchar *>(data);
+        QChar *out = text.data();
+        for (int i=0; i<text.length(); i++) {
+            out[i] = QChar(encoding == Utf16LE ? qFromLittleEndian<quint16>(bytes + i * 2)
+                                               : qFromBigEndian<quint16>(bytes + i * 2));
+        }
+        return text;
+    }
+    default: {
+        qint64 ascii = asciiPrefix(data, size);
+        if (ascii == size) return QString::fromLatin1(data, int(size));
+        if (ascii == 0) return QString::fromUtf8(data, int(size));
+        return QString::fromLatin1(data, int(ascii)) + QString::fromUtf8(data + ascii, int(size - ascii));
+    }
+    }
+}
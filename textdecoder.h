@@ -0,0 +1,80 @@
+/********************************************************************
+
+Name: Versatacts
+Homepage: http://github.com/ae5chylu5/versatacts
+Author: ae5chylu5
+Description: A versatile gui application capable of extracting and
+             converting contacts to/from a variety of popular
+             mobile formats.
+
+Copyright (C) 2016 ae5chylu5
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+********************************************************************/
+
+#ifndef TEXTDECODER_H
+#define TEXTDECODER_H
+
+#include <QString>
+#include <QtEndian>
+
+#include <string.h>
+
+// TextDecoder works out the encoding of a text file once and hands back
+// its lines. a byte order mark decides between utf-8 and utf-16. without
+// one, utf-16 is recognized by its zero bytes and anything that isn't
+// valid utf-8 is taken as latin-1, which is what most sim tools write.
+//
+// a file that isn't in memory in one piece, e.g. a compressed one, is
+// handed over in chunks with setData(). the encoding of the first chunk
+// is kept and readLine() leaves a line that runs past the end of a chunk
+// for the next one. a character cut off by the end of the first chunk
+// doesn't count against utf-8.
+//
+// the ascii checks look at eight bytes at a time. ascii text, by far
+// the most common case, is converted with fromLatin1() and only the
+// part after the first other byte goes through the utf-8 decoder.
+class TextDecoder
+{
+public:
+    enum Encoding {
+        Utf8,
+        Utf16LE,
+        Utf16BE,
+        Latin1
+    };
+
+    TextDecoder(const char *data = 0, qint64 size = 0);
+    void setData(const char *data, qint64 size, bool isFinal = true);
+    bool readLine(QString &line);
+    Encoding encoding() const;
+    qint64 position() const;
+    qint64 size() const;
+    static Encoding detect(const char *data, qint64 size, int *bomLength, bool isPartial = false);
+    static qint64 asciiPrefix(const char *data, qint64 size);
+    static bool isUtf8(const char *data, qint64 size, bool isPartial = false);
+    static QString decode(const char *data, qint64 size, Encoding encoding);
+
+private:
+    static const int sampleSize = 4096; // bytes looked at for utf-16
+    const char *data;
+    qint64 dataSize;
+    qint64 pos;
+    bool isFinal; // no data follows the current buffer
+    bool isDetected; // the encoding was worked out from a non empty buffer
+    Encoding textEncoding;
+};
+
+#endif // TEXTDECODER_H
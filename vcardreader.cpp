@@ -0,0 +1,334 @@
+/********************************************************************
+
+Name: Versatacts
+Homepage: http://github.com/ae5chylu5/versatacts
+Author: ae5chylu5
+Description: A versatile gui application capable of extracting and
+             converting contacts to/from a variety of popular
+             mobile formats.
+
+Copyright (C) 2016 ae5chylu5
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+********************************************************************/
+
+#include "vcardreader.h"
+
+VcardReader::VcardReader(const char *data, qint64 size)
+    : data(data), dataSize(size), pos(0), textEncoding(TextDecoder::Utf8)
+{
+
+}
+
+// hands back the next property. the views stay valid until the next
+// call. returns false at the end of the buffer.
+bool VcardReader::readProperty(Property &property)
+{
+    qint64 next,end;
+
+    while (pos < dataSize) {
+        end = lineEnd(pos, &next);
+
+        // skip blank lines between cards
+        if (end == pos) {
+            pos = next;
+            continue;
+        }
+
+        // a trailing = only continues the line if the value is quoted
+        // printable so look at the parameters first
+        const char *start = data + pos;
+        int length = end - pos;
+        const char *colon = static_cast<const char *>(memchr(start, ':', length));
+        View head = {start, colon ? int(colon - start) : length};
+        bool isQuotedPrintable = head.contains("QUOTED-PRINTABLE");
+        bool isSoftBreak = isQuotedPrintable && start[length - 1] == '=';
+        pos = next;
+
+        if (!isContinued(pos, isSoftBreak)) {
+            View line = {start, length};
+            split(line, property);
+            return true;
+        }
+
+        // folded lines are joined in a buffer that keeps its allocation
+        unfolded.resize(0);
+        unfolded.append(start, isSoftBreak ? length - 1 : length);
+        while (isContinued(pos, isSoftBreak)) {
+            end = lineEnd(pos, &next);
+            start = data + pos;
+            length = end - pos;
+            // folding inserts a single space or tab. soft breaks don't.
+            if (!isSoftBreak) {
+                start++;
+                length--;
+            }
+            isSoftBreak = isQuotedPrintable && length > 0 && start[length - 1] == '=';
+            unfolded.append(start, isSoftBreak ? length - 1 : length);
+            pos = next;
+        }
+
+        View line = {unfolded.constData(), unfolded.size()};
+        split(line, property);
+        return true;
+    }
+    return false;
+}
+
+qint64 VcardReader::position() const
+{
+    return pos;
+}
+
+qint64 VcardReader::size() const
+{
+    return dataSize;
+}
+
+// only utf-8 and latin-1 can be read, utf-16 files have to be
+// transcoded first
+void VcardReader::setTextEncoding(TextDecoder::Encoding encoding)
+{
+    textEncoding = encoding;
+}
+
+// the value as text with quoted printable and charsets decoded
+QString VcardReader::decodedValue(const Property &property)
+{
+    return decode(property.value, property.isQuotedPrintable, property.params);
+}
+
+// the complete line as text. quoted printable values are decoded and
+// written as a plain vcard 3.0 line with escaped line breaks so the
+// ENCODING and CHARSET parameters are dropped.
+QString VcardReader::textLine(const Property &property)
+{
+    View charset = paramValue(property.params, "CHARSET");
+    if (!property.isQuotedPrintable && charset.isEmpty()) {
+        return TextDecoder::decode(property.line.data, property.line.length, textEncoding);
+    }
+
+    QString line = TextDecoder::decode(property.line.data, property.name.data + property.name.length - property.line.data, textEncoding);
+    View param;
+    int from = 0;
+    while (nextParam(property.params, &from, &param)) {
+        if (param.equals("QUOTED-PRINTABLE") ||
+            (param.length > 9 && qstrnicmp(param.data, "ENCODING=", 9) == 0) ||
+            (param.length > 8 && qstrnicmp(param.data, "CHARSET=", 8) == 0)) continue;
+        line.append(QLatin1Char(';')).append(param.toString());
+    }
+
+    QString value = decode(property.value, property.isQuotedPrintable, property.params);
+    value.replace(QLatin1String("\r\n"), QLatin1String("\\n"));
+    value.replace(QLatin1Char('\n'), QLatin1String("\\n"));
+    return line.append(QLatin1Char(':')).append(value);
+}
+
+// returns the value of the parameter name or an empty view. quotes
+// around the value are removed.
+VcardReader::View VcardReader::paramValue(const View &params, const char *name)
+{
+    int nameLength = qstrlen(name);
+    View param;
+    int from = 0;
+    while (nextParam(params, &from, &param)) {
+        if (param.length <= nameLength || param.data[nameLength] != '=' ||
+            qstrnicmp(param.data, name, nameLength) != 0) continue;
+
+        View value = {param.data + nameLength + 1, param.length - nameLength - 1};
+        if (value.length >= 2 && value.data[0] == '"' && value.data[value.length - 1] == '"') {
+            value.data++;
+            value.length -= 2;
+        }
+        return value;
+    }
+    View none = {0, 0};
+    return none;
+}
+
+// resolves the backslash escapes of vcard 3.0 and 4.0 values
+QString VcardReader::unescaped(const QString &value)
+{
+    if (!value.contains(QLatin1Char('\\'))) return value;
+
+    QString out;
+    out.reserve(value.length());
+    for (int i=0; i<value.length(); i++) {
+        QChar c = value.at(i);
+        if (c == QLatin1Char('\\') && i + 1 < value.length()) {
+            c = value.at(++i);
+            if (c == QLatin1Char('n') || c == QLatin1Char('N')) c = QLatin1Char('\n');
+        }
+        out.append(c);
+    }
+    return out;
+}
+
+// splits a structured value such as N: at the unescaped semicolons
+QStringList VcardReader::components(const QString &value)
+{
+    QStringList list;
+    int start = 0;
+    for (int i=0; i<=value.length(); i++) {
+        if (i < value.length()) {
+            if (value.at(i) == QLatin1Char('\\')) {
+                i++;
+                continue;
+            }
+            if (value.at(i) != QLatin1Char(';')) continue;
+        }
+        list.append(unescaped(value.mid(start, i - start)));
+        start = i + 1;
+    }
+    return list;
+}
+
+// returns the end of the line starting at from without the line break.
+// next is set to the start of the following line.
+qint64 VcardReader::lineEnd(qint64 from, qint64 *next) const
+{
+    const char *newline = static_cast<const char *>(memchr(data + from, '\n', dataSize - from));
+    qint64 end = newline ? newline - data : dataSize;
+    *next = newline ? end + 1 : dataSize;
+    if (end > from && data[end - 1] == '\r') end--;
+    return end;
+}
+
+bool VcardReader::isContinued(qint64 next, bool isSoftBreak) const
+{
+    if (next >= dataSize) return false;
+    if (isSoftBreak) return data[next] != '\r' && data[next] != '\n';
+    return data[next] == ' ' || data[next] == '\t';
+}
+
+// finds the name, parameters and value of a line. colons and semicolons
+// inside quoted parameter values don't count.
+void VcardReader::split(const View &line, Property &property)
+{
+    int nameEnd = -1;
+    int colon = line.length;
+    bool isQuoted = false;
+
+    for (int i=0; i<line.length; i++) {
+        char c = line.data[i];
+        if (c == '"') {
+            isQuoted = !isQuoted;
+        } else if (!isQuoted) {
+            if (c == ':') {
+                colon = i;
+                break;
+            }
+            if (c == ';' && nameEnd < 0) nameEnd = i;
+        }
+    }
+    if (nameEnd < 0) nameEnd = colon;
+
+    property.line = line;
+    property.name.data = line.data;
+    property.name.length = nameEnd;
+    property.group.data = line.data;
+    property.group.length = 0;
+
+    const char *dot = static_cast<const char *>(memchr(line.data, '.', nameEnd));
+    if (dot) {
+        property.group.length = dot - line.data;
+        property.name.data = dot + 1;
+        property.name.length = nameEnd - property.group.length - 1;
+    }
+
+    property.params.data = line.data + nameEnd + 1;
+    property.params.length = nameEnd < colon ? colon - nameEnd - 1 : 0;
+    property.value.data = line.data + qMin(colon + 1, line.length);
+    property.value.length = qMax(line.length - colon - 1, 0);
+    property.isQuotedPrintable = property.params.contains("QUOTED-PRINTABLE");
+}
+
+// steps through the semicolon separated parameters
+bool VcardReader::nextParam(const View &params, int *from, View *param)
+{
+    if (*from >= params.length) return false;
+
+    bool isQuoted = false;
+    int i = *from;
+    for (; i<params.length; i++) {
+        if (params.data[i] == '"') isQuoted = !isQuoted;
+        if (params.data[i] == ';' && !isQuoted) break;
+    }
+    param->data = params.data + *from;
+    param->length = i - *from;
+    *from = i + 1;
+    return true;
+}
+
+QString VcardReader::decode(const View &value, bool isQuotedPrintable, const View &params)
+{
+    const char *bytes = value.data;
+    int length = value.length;
+
+    if (isQuotedPrintable) {
+        decoded.resize(0);
+        decoded.reserve(length);
+        int hi,lo;
+        for (int i=0; i<length; i++) {
+            if (value.data[i] == '=' && i + 2 < length &&
+                (hi = hexValue(value.data[i + 1])) >= 0 && (lo = hexValue(value.data[i + 2])) >= 0) {
+                decoded.append(char(hi << 4 | lo));
+                i += 2;
+            } else {
+                decoded.append(value.data[i]);
+            }
+        }
+        bytes = decoded.constData();
+        length = decoded.size();
+    }
+
+    // utf-8 is the default of vcard 3.0 and 4.0. 2.1 may name another
+    // charset, otherwise the encoding of the file applies.
+    View charset = paramValue(params, "CHARSET");
+    if (!charset.isEmpty() && !charset.equals("UTF-8")) {
+        QTextCodec *codec = QTextCodec::codecForName(QByteArray(charset.data, charset.length));
+        if (codec) return codec->toUnicode(bytes, length);
+    } else if (!charset.isEmpty()) {
+        return TextDecoder::decode(bytes, length, TextDecoder::Utf8);
+    }
+    return TextDecoder::decode(bytes, length, textEncoding);
+}
+
+int VcardReader::hexValue(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+bool VcardReader::View::equals(const char *text) const
+{
+    return int(qstrlen(text)) == length && qstrnicmp(data, text, length) == 0;
+}
+
+bool VcardReader::View::contains(const char *text) const
+{
+    int textLength = qstrlen(text);
+    for (int i=0; i+textLength<=length; i++) {
+        if (qstrnicmp(data + i, text, textLength) == 0) return true;
+    }
+    return false;
+}
+
+QString VcardReader::View::toString() const
+{
+    return TextDecoder::decode(data, length, TextDecoder::Utf8);
+}
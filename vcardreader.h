@@ -0,0 +1,99 @@
+/********************************************************************
+
+Name: Versatacts
+Homepage: http://github.com/ae5chylu5/versatacts
+Author: ae5chylu5
+Description: A versatile gui application capable of extracting and
+             converting contacts to/from a variety of popular
+             mobile formats.
+
+Copyright (C) 2016 ae5chylu5
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+********************************************************************/
+
+#ifndef VCARDREADER_H
+#define VCARDREADER_H
+
+#include "textdecoder.h"
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <QTextCodec>
+
+#include <string.h>
+
+// VcardReader splits a vcf file into its properties in a single pass.
+// it understands vcard 2.1, 3.0 and 4.0 and any number of cards per
+// file. the buffer is usually a memory mapped file and the views handed
+// back point straight into it. only folded lines are copied, into a
+// buffer that is reused for every property.
+//
+// a property is [group.]NAME[;param...]:value. lines starting with a
+// space or tab continue the previous line. quoted printable values of
+// vcard 2.1 continue after a line ending with a soft break (=).
+//
+// the buffer is utf-8 unless setTextEncoding() says otherwise. values
+// with a CHARSET parameter use that instead.
+class VcardReader
+{
+public:
+    struct View {
+        const char *data;
+        int length;
+
+        bool isEmpty() const { return length == 0; }
+        bool equals(const char *text) const;
+        bool contains(const char *text) const;
+        QString toString() const;
+    };
+
+    struct Property {
+        View line; // the complete unfolded line
+        View group;
+        View name;
+        View params; // without the leading semicolon
+        View value;
+        bool isQuotedPrintable;
+    };
+
+    VcardReader(const char *data, qint64 size);
+    bool readProperty(Property &property);
+    qint64 position() const;
+    qint64 size() const;
+    void setTextEncoding(TextDecoder::Encoding encoding);
+    QString decodedValue(const Property &property);
+    QString textLine(const Property &property);
+    static View paramValue(const View &params, const char *name);
+    static QString unescaped(const QString &value);
+    static QStringList components(const QString &value);
+    static void split(const View &line, Property &property);
+    static bool nextParam(const View &params, int *from, View *param);
+
+private:
+    qint64 lineEnd(qint64 from, qint64 *next) const;
+    bool isContinued(qint64 next, bool isSoftBreak) const;
+    QString decode(const View &value, bool isQuotedPrintable, const View &params);
+    static int hexValue(char c);
+    const char *data;
+    qint64 dataSize;
+    qint64 pos;
+    TextDecoder::Encoding textEncoding;
+    QByteArray unfolded;
+    QByteArray decoded;
+};
+
+#endif // VCARDREADER_H
@@ -0,0 +1,181 @@
+/********************************************************************
+
+Name: Versatacts
+Homepage: http://github.com/ae5chylu5/versatacts
+Author: ae5chylu5
+Description: A versatile gui application capable of extracting and
+             converting contacts to/from a variety of popular
+             mobile formats.
+
+Copyright (C) 2016 ae5chylu5
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+********************************************************************/
+
+#include "vcfwriter.h"
+
+VcfWriter::VcfWriter(QIODevice *device, int chunkSize)
+    : device(device), chunkSize(chunkSize), totalWritten(0), error(false)
+{
+    buffer.reserve(chunkSize + 4096);
+}
+
+VcfWriter::~VcfWriter()
+{
+    flush();
+}
+
+void VcfWriter::writeRecord(const ContactStore &store, int record)
+{
+    formatRecord(store, record, buffer, this);
+    if (buffer.size() >= chunkSize) flush();
+}
+
+bool VcfWriter::flush()
+{
+    if (buffer.isEmpty()) return !error;
+
+    // vcard 3.0 is utf-8 whatever the locale of the machine
+    QByteArray data = buffer.toUtf8();
+    qint64 written = device->write(data);
+    if (written != data.size()) error = true;
+    if (written > 0) totalWritten += written;
+
+    // keep the allocation around for the next chunk
+    buffer.resize(0);
+    return !error;
+}
+
+bool VcfWriter::hasError() const
+{
+    return error;
+}
+
+qint64 VcfWriter::bytesWritten() const
+{
+    return totalWritten;
+}
+
+// the text in front of the bytes is written first so the card keeps
+// its order. continuation lines start with a space which counts towards
+// their length.
+void VcfWriter::writeBinary(const QByteArray &bytes)
+{
+    flush();
+
+    QByteArray line = binaryLine(bytes);
+    QByteArray folded;
+    folded.reserve(line.size() + line.size() / (maxLineLength - 1) * 2 + 1);
+    int length = qMin(line.size(), maxLineLength);
+    folded.append(line.constData(), length);
+    for (int i=length; i<line.size(); i+=maxLineLength-1) {
+        folded.append("\n ", 2);
+        folded.append(line.constData() + i, qMin(maxLineLength - 1, line.size() - i));
+    }
+    folded.append('\n');
+
+    qint64 written = device->write(folded);
+    if (written != folded.size()) error = true;
+    if (written > 0) totalWritten += written;
+}
+
+// the unfolded line of a binary property as vcard 3.0 has it. the
+// ENCODING=BASE64 and bare type parameters of 2.1 and the data uris of
+// 4.0 become ENCODING=b and TYPE. the base64 data is copied as it is.
+QByteArray VcfWriter::binaryLine(const QByteArray &bytes)
+{
+    VcardReader::View line = {bytes.constData(), bytes.size()};
+    VcardReader::Property property;
+    VcardReader::split(line, property);
+
+    QByteArray out(property.line.data, property.name.data + property.name.length - property.line.data);
+    QByteArray value(property.value.data, property.value.length);
+    QByteArray type;
+
+    // data:image/jpeg;base64,... holds the type in front of the data.
+    // other data uris stay uris.
+    if (value.length() > 5 && qstrnicmp(value.constData(), "data:", 5) == 0) {
+        int comma = value.indexOf(',');
+        QByteArray header = value.mid(5, comma - 5).toLower();
+        if (comma < 0 || !header.endsWith(";base64")) return out + ";VALUE=uri:" + value;
+        QByteArray mediaType = header.left(header.indexOf(';'));
+        type = mediaType.mid(mediaType.indexOf('/') + 1).toUpper();
+        value = value.mid(comma + 1);
+    }
+
+    out.append(";ENCODING=b");
+    VcardReader::View param;
+    int from = 0;
+    bool hasType = false;
+    while (VcardReader::nextParam(property.params, &from, &param)) {
+        QByteArray text(param.data, param.length);
+        int equals = text.indexOf('=');
+        QByteArray name = text.left(equals < 0 ? text.length() : equals).trimmed().toUpper();
+        if (name.isEmpty() || name == "ENCODING" || name == "BASE64" || name == "VALUE" || name == "MEDIATYPE") continue;
+
+        // 2.1 lists the type without a name
+        if (equals < 0) text.prepend("TYPE=");
+        if (equals < 0 || name == "TYPE") hasType = true;
+        out.append(';').append(text);
+    }
+    if (!hasType && !type.isEmpty()) out.append(";TYPE=").append(type);
+
+    // 2.1 writers indent the folded base64 lines by more than one space
+    value.replace(' ', QByteArray()).replace('\t', QByteArray());
+    return out.append(':').append(value);
+}
+
+// appends a single vcard to out. the name properties are written in
+// front of the first field that isn't a name. binary fields go straight
+// to the device of writer and are left out without one, e.g. in the
+// preview.
+void VcfWriter::formatRecord(const ContactStore &store, int record, QString &out, VcfWriter *writer)
+{
+    QStringRef names[2];
+    int nameCount = 0;
+    int fieldCount = store.fieldCount(record);
+    bool isName;
+    bool isNameOutput = false;
+    const char *property;
+
+    out.append(QLatin1String("BEGIN:VCARD\nVERSION:3.0\n"));
+    for (int j=0; j<fieldCount; j++) {
+        const ContactStore::Field &f = store.field(record, j);
+        isName = f.kind == ContactStore::FirstName || f.kind == ContactStore::LastName;
+        if (isName) {
+            if (nameCount < 2) names[nameCount] = store.value(f);
+            nameCount++;
+            if (fieldCount > j + 1) continue;
+        }
+
+        // isNameOutput keeps track of whether we've written the name
+        if (!isNameOutput) {
+            out.append(QLatin1String("n:")).append(names[1]).append(QLatin1Char(';'))
+               .append(names[0]).append(QLatin1String(";;;;\n"));
+            out.append(QLatin1String("FN:")).append(names[0]).append(QLatin1Char(' '))
+               .append(names[1]).append(QLatin1Char('\n'));
+            isNameOutput = true;
+        }
+
+        if (f.kind == ContactStore::Binary) {
+            if (writer) writer->writeBinary(store.binary(f));
+        } else if (!isName) {
+            property = ContactStore::propertyName(f);
+            if (property) out.append(QLatin1String(property)).append(QLatin1Char(':'));
+            out.append(store.value(f)).append(QLatin1Char('\n'));
+        }
+    }
+    out.append(QLatin1String("END:VCARD\n"));
+}
@@ -0,0 +1,63 @@
+/********************************************************************
+
+Name: Versatacts
+Homepage: http://github.com/ae5chylu5/versatacts
+Author: ae5chylu5
+Description: A versatile gui application capable of extracting and
+             converting contacts to/from a variety of popular
+             mobile formats.
+
+Copyright (C) 2016 ae5chylu5
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+********************************************************************/
+
+#ifndef VCFWRITER_H
+#define VCFWRITER_H
+
+#include "contactstore.h"
+#include "vcardreader.h"
+
+#include <QIODevice>
+#include <QString>
+
+// VcfWriter serializes records of a ContactStore straight to a device.
+// cards are formatted into a buffer which is encoded and written once
+// it grows past the chunk size so the device sees a few large writes.
+// binary fields are written to the device as vcard 3.0 lines folded at
+// 75 octets, their base64 data is never decoded.
+class VcfWriter
+{
+public:
+    VcfWriter(QIODevice *device, int chunkSize = 256 * 1024);
+    ~VcfWriter();
+    void writeRecord(const ContactStore &store, int record);
+    bool flush();
+    bool hasError() const;
+    qint64 bytesWritten() const;
+    static void formatRecord(const ContactStore &store, int record, QString &out, VcfWriter *writer = 0);
+
+private:
+    void writeBinary(const QByteArray &bytes);
+    static QByteArray binaryLine(const QByteArray &bytes);
+    static const int maxLineLength = 75; // octets of a line without the break
+    QIODevice *device;
+    QString buffer;
+    int chunkSize;
+    qint64 totalWritten;
+    bool error;
+};
+
+#endif // VCFWRITER_H
@@ -0,0 +1,50 @@
+# Sources shared by the gui and the command line tool. Only qtcore is
+# required so headless builds don't need to link against qtgui.
+
+QT += concurrent
+CONFIG += c++11
+
+# gzip input and output use the system zlib. zstd is optional, run
+# qmake CONFIG+=zstd to build it in.
+LIBS += -lz
+zstd {
+    DEFINES += VERSATACTS_ZSTD
+    LIBS += -lzstd
+}
+
+INCLUDEPATH += $$PWD
+DEPENDPATH += $$PWD
+
+SOURCES += $$PWD/compresseddevice.cpp \
+           $$PWD/contactconverter.cpp \
+           $$PWD/contactdeduper.cpp \
+           $$PWD/contactindex.cpp \
+           $$PWD/contactsnapshot.cpp \
+           $$PWD/contactstore.cpp \
+           $$PWD/fieldclassifier.cpp \
+           $$PWD/folderwatcher.cpp \
+           $$PWD/formatsniffer.cpp \
+           $$PWD/mergecache.cpp \
+           $$PWD/pbbdecoder.cpp \
+           $$PWD/stagereport.cpp \
+           $$PWD/textdecoder.cpp \
+           $$PWD/vcardreader.cpp \
+           $$PWD/vcfwriter.cpp
+
+HEADERS += $$PWD/boundedqueue.h \
+           $$PWD/compresseddevice.h \
+           $$PWD/contactconverter.h \
+           $$PWD/contactdeduper.h \
+           $$PWD/contactindex.h \
+           $$PWD/contactsnapshot.h \
+           $$PWD/contactstore.h \
+           $$PWD/fieldclassifier.h \
+           $$PWD/folderwatcher.h \
+           $$PWD/formatsniffer.h \
+           $$PWD/mappedvector.h \
+           $$PWD/mergecache.h \
+           $$PWD/pbbdecoder.h \
+           $$PWD/stagereport.h \
+           $$PWD/textdecoder.h \
+           $$PWD/vcardreader.h \
+           $$PWD/vcfwriter.h
@@ -29,6 +29,27 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 Versatacts::Versatacts(QWidget *parent)
     : QMainWindow(parent)
 {
+    converter = new ContactConverter(this);
+    folderWatcher = new FolderWatcher(this);
+    jobWatcher = new QFutureWatcher<bool>(this);
+    jobKind = NoJob;
+    pendingAction = NoAction;
+    saveFile = 0;
+    saveDeflater = 0;
+    saveStage = 0;
+
+    // merge/threads caps the number of threads used to parse folders.
+    // 0 or a missing value uses one thread per core. merge/cache keeps
+    // the records of merged folders so only changed files are parsed
+    // again, merge/verifyCache also compares them by content.
+    // merge/binaryLimit drops photos larger than the given number of
+    // bytes, 0 drops all of them.
+    QSettings settings;
+    converter->setMaxThreads(settings.value("merge/threads", 0).toInt());
+    converter->setMergeCache(settings.value("merge/cache", true).toBool(),
+                             settings.value("merge/verifyCache", false).toBool());
+    converter->setBinaryLimit(settings.value("merge/binaryLimit", -1).toInt());
+
     QLabel *contactsPathLabel = new QLabel;
     contactsPathLabel->setText(tr("Input Path:"));
     contactsPathLabel->setStyleSheet("QLabel {font-size:11px; font-weight:700;}");
@@ -57,15 +78,77 @@ Versatacts::Versatacts(QWidget *parent)
     totalLabel->setText(tr("Total Records: 0"));
     totalLabel->setStyleSheet("QLabel {font-size:11px; font-weight:700;}");
 
+    // the list is only a preview. saving always writes the records
+    // directly so the preview can be turned off.
+    previewCheckBox = new QCheckBox;
+    previewCheckBox->setText(tr("Preview"));
+    previewCheckBox->setToolTip(tr("Display the imported contacts"));
+    previewCheckBox->setStyleSheet("QCheckBox {font-size:11px;}");
+    previewCheckBox->setChecked(true);
+
+    // duplicates are collapsed while importing. the choice is kept for
+    // the next session.
+    dedupCheckBox = new QCheckBox;
+    dedupCheckBox->setText(tr("Merge Duplicates"));
+    dedupCheckBox->setToolTip(tr("Merge contacts sharing a name and phone number or email when importing"));
+    dedupCheckBox->setStyleSheet("QCheckBox {font-size:11px;}");
+    dedupCheckBox->setChecked(settings.value("import/deduplicate", false).toBool());
+
     QHBoxLayout *labelLayout = new QHBoxLayout;
+    labelLayout->addWidget(dedupCheckBox, 0, Qt::AlignLeft);
     labelLayout->addStretch(1);
     labelLayout->addWidget(totalLabel, 0, Qt::AlignCenter);
     labelLayout->addStretch(1);
-
-    vcfTextEdit = new QTextEdit;
+    labelLayout->addWidget(previewCheckBox, 0, Qt::AlignRight);
+
+    // the list only asks the model for the rows that are visible. the
+    // vcard of the current row is shown below it where it can be edited.
+    contactModel = new ContactModel(&converter->records, this);
+
+    contactsView = new QListView;
+    contactsView->setModel(contactModel);
+    contactsView->setUniformItemSizes(true);
+    contactsView->setLayoutMode(QListView::Batched);
+    contactsView->setEditTriggers(QAbstractItemView::NoEditTriggers);
+
+    // every keystroke filters the list through the search index of the
+    // converter instead of scanning the records
+    searchLineEdit = new QLineEdit;
+    searchLineEdit->setPlaceholderText(tr("Search names or phone numbers"));
+    searchLineEdit->setClearButtonEnabled(true);
+
+    QVBoxLayout *listLayout = new QVBoxLayout;
+    listLayout->setContentsMargins(0, 0, 0, 0);
+    listLayout->addWidget(searchLineEdit);
+    listLayout->addWidget(contactsView, 1);
+
+    QWidget *listWidget = new QWidget;
+    listWidget->setLayout(listLayout);
+
+    cardEdit = new QPlainTextEdit;
+    cardEdit->setEnabled(false);
+
+    applyButton = new QPushButton;
+    applyButton->setText(tr("Apply"));
+    applyButton->setToolTip(tr("Save changes to the selected contact"));
+    applyButton->setEnabled(false);
+
+    QVBoxLayout *cardLayout = new QVBoxLayout;
+    cardLayout->setContentsMargins(0, 0, 0, 0);
+    cardLayout->addWidget(cardEdit, 1);
+    cardLayout->addWidget(applyButton, 0, Qt::AlignRight);
+
+    QWidget *cardWidget = new QWidget;
+    cardWidget->setLayout(cardLayout);
+
+    previewSplitter = new QSplitter(Qt::Vertical);
+    previewSplitter->addWidget(listWidget);
+    previewSplitter->addWidget(cardWidget);
+    previewSplitter->setStretchFactor(0, 2);
+    previewSplitter->setStretchFactor(1, 1);
 
     QHBoxLayout *vcfTextLayout = new QHBoxLayout;
-    vcfTextLayout->addWidget(vcfTextEdit, 1);
+    vcfTextLayout->addWidget(previewSplitter, 1);
 
     resetButton = new QToolButton;
     resetButton->setIcon(QIcon(":/images/reset48.png"));
@@ -110,6 +193,34 @@ Versatacts::Versatacts(QWidget *parent)
     centralWidget->setLayout(mainLayout);
     setCentralWidget(centralWidget);
 
+    // imports and exports run in the background. their progress is shown
+    // in the status bar so the window stays usable in the meantime.
+    progressLabel = new QLabel;
+    progressLabel->setStyleSheet("QLabel {font-size:11px;}");
+
+    progressBar = new QProgressBar;
+    progressBar->setMaximumWidth(200);
+
+    cancelButton = new QPushButton;
+    cancelButton->setText(tr("Abort"));
+
+    statusBar()->addWidget(progressLabel, 1);
+    statusBar()->addPermanentWidget(progressBar);
+    statusBar()->addPermanentWidget(cancelButton);
+    progressLabel->setVisible(false);
+    progressBar->setVisible(false);
+    cancelButton->setVisible(false);
+
+    // the timings of every stage run in this session can be saved as json
+    QMenu *toolsMenu = menuBar()->addMenu(tr("&Tools"));
+    saveSnapshotAction = toolsMenu->addAction(tr("Save Snapshot..."));
+    saveReportAction = toolsMenu->addAction(tr("Save Timing Report..."));
+
+    // a watched folder keeps adding the cards of new files to a vcf
+    toolsMenu->addSeparator();
+    watchFolderAction = toolsMenu->addAction(tr("Watch Folder..."));
+    watchFolderAction->setCheckable(true);
+
     connectEvents();
     setMinimumSize(500, 500);
     setWindowTitle("Versatacts v0.2");
@@ -120,6 +231,18 @@ Versatacts::~Versatacts()
 
 }
 
+void Versatacts::closeEvent(QCloseEvent *event)
+{
+    // the background job uses the converter so it has to end before
+    // the window and its children are destroyed
+    if (jobWatcher->isRunning()) {
+        converter->cancel();
+        jobWatcher->waitForFinished();
+    }
+    folderWatcher->stop();
+    QMainWindow::closeEvent(event);
+}
+
 void Versatacts::connectEvents()
 {
     connect(selectFileButton, SIGNAL(clicked()), this, SLOT(selectContactsFile()));
@@ -128,7 +251,160 @@ void Versatacts::connectEvents()
     connect(importButton, SIGNAL(clicked()), this, SLOT(importRecords()));
     connect(saveButton, SIGNAL(clicked()), this, SLOT(saveVCF()));
     connect(reverseButton, SIGNAL(clicked()), this, SLOT(reverseNames()));
+    connect(previewCheckBox, SIGNAL(toggled(bool)), this, SLOT(togglePreview(bool)));
+    connect(saveSnapshotAction, SIGNAL(triggered()), this, SLOT(saveSnapshot()));
+    connect(saveReportAction, SIGNAL(triggered()), this, SLOT(saveReport()));
+    connect(watchFolderAction, SIGNAL(toggled(bool)), this, SLOT(toggleWatch(bool)));
+    connect(folderWatcher, SIGNAL(ingested(QStringList,int)), this, SLOT(showIngested(QStringList,int)));
+    connect(folderWatcher, SIGNAL(warning(QString)), this, SLOT(showStatus(QString)));
+    connect(contactsView->selectionModel(), SIGNAL(currentChanged(QModelIndex,QModelIndex)), this, SLOT(showCard(QModelIndex)));
+    connect(applyButton, SIGNAL(clicked()), this, SLOT(applyCard()));
+    connect(cancelButton, SIGNAL(clicked()), converter, SLOT(cancel()));
+    connect(jobWatcher, SIGNAL(finished()), this, SLOT(finishJob()));
     connect(contactsPathLineEdit, SIGNAL(textChanged(QString)), this, SLOT(importRecords()));
+    connect(searchLineEdit, SIGNAL(textChanged(QString)), this, SLOT(filterContacts(QString)));
+    connect(converter, SIGNAL(progressStarted(QString,int)), this, SLOT(startProgress(QString,int)));
+    connect(converter, SIGNAL(progressChanged(int)), this, SLOT(updateProgress(int)));
+    connect(converter, SIGNAL(progressFinished()), this, SLOT(finishProgress()));
+    connect(converter, SIGNAL(warning(QString)), this, SLOT(showWarning(QString)));
+}
+
+// the converter emits these from the job thread. they arrive here as
+// queued signals at most every few milliseconds.
+void Versatacts::startProgress(const QString &label, int maximum)
+{
+    progressLabel->setText(label);
+    progressBar->setRange(0, maximum);
+    progressBar->setValue(0);
+}
+
+void Versatacts::updateProgress(int value)
+{
+    progressBar->setValue(value);
+}
+
+void Versatacts::finishProgress()
+{
+    progressBar->setValue(progressBar->maximum());
+}
+
+void Versatacts::showWarning(const QString &message)
+{
+    QMessageBox::information(this, tr("Versatacts"), message + tr(" Please try again."));
+}
+
+void Versatacts::setBusy(bool busy)
+{
+    selectFileButton->setEnabled(!busy);
+    selectFolderButton->setEnabled(!busy);
+    resetButton->setEnabled(!busy);
+    reverseButton->setEnabled(!busy);
+    saveButton->setEnabled(!busy);
+    saveSnapshotAction->setEnabled(!busy);
+    saveReportAction->setEnabled(!busy);
+    searchLineEdit->setEnabled(!busy);
+    progressLabel->setVisible(busy);
+    progressBar->setVisible(busy);
+    cancelButton->setVisible(busy);
+    showCard(contactsView->currentIndex());
+
+    // every job starts here so a cancel is only cleared before a new one
+    if (busy) converter->resetCancel();
+}
+
+void Versatacts::finishJob()
+{
+    bool ok = jobWatcher->result();
+    JobKind kind = jobKind;
+    PendingAction action = pendingAction;
+    jobKind = NoJob;
+    pendingAction = NoAction;
+    setBusy(false);
+
+    if (kind == SaveJob) {
+        // the end of a compressed stream is written before the file closes
+        if (saveDeflater) {
+            ok = saveDeflater->finish() && ok;
+            delete saveDeflater;
+            saveDeflater = 0;
+        }
+        saveFile->close();
+        saveStage->count("records", converter->records.count());
+        saveStage->count("bytesWritten", saveFile->size());
+        converter->stageReport()->add(*saveStage);
+        delete saveStage;
+        saveStage = 0;
+        delete saveFile;
+        saveFile = 0;
+
+        if (!ok) {
+            QMessageBox::information(this, tr("Versatacts"), tr("The output file could not be written. Please try again."));
+        } else if (converter->isCanceled()) {
+            QMessageBox::information(this, tr("Versatacts"), tr("The export was aborted."));
+        } else {
+            QMessageBox::information(this, tr("Versatacts"), tr("Success!"));
+        }
+        return;
+    }
+
+    if (kind == ShardJob) {
+        if (!ok) {
+            QMessageBox::information(this, tr("Versatacts"), tr("The output file could not be written. Please try again."));
+        } else if (converter->isCanceled()) {
+            QMessageBox::information(this, tr("Versatacts"), tr("The export was aborted."));
+        } else {
+            QMessageBox::information(this, tr("Versatacts"), tr("Success! %1 files were written.").arg(converter->shardFiles().count()));
+        }
+        return;
+    }
+
+    if (kind == SnapshotJob) {
+        if (!ok) {
+            QMessageBox::information(this, tr("Versatacts"), tr("The snapshot could not be written. Please try again."));
+        } else {
+            QMessageBox::information(this, tr("Versatacts"), tr("Success!"));
+        }
+        return;
+    }
+
+    // the records are complete so the model may read them again. a
+    // search typed before the import applies to the new records.
+    contactModel->setSuspended(false);
+    filterContacts(searchLineEdit->text());
+    showCard(QModelIndex());
+
+    // the files of a selection that failed are listed in one message
+    QStringList fileErrors = converter->fileErrors();
+    if (!fileErrors.isEmpty()) {
+        QMessageBox box(QMessageBox::Information, tr("Versatacts"),
+                        ok ? tr("%1 files could not be imported.").arg(fileErrors.count())
+                           : converter->errorString() + tr(" Please try again."),
+                        QMessageBox::Ok, this);
+        box.setDetailedText(fileErrors.join("\n"));
+        box.exec();
+        if (!ok) return;
+    }
+
+    if (!ok) {
+        QMessageBox::information(this, tr("Versatacts"), converter->errorString() + tr(" Please try again."));
+        return;
+    }
+
+    QString total = tr("Total Records: ").append(QString::number(converter->records.count()));
+    if (converter->duplicatesMerged() > 0) {
+        total.append(tr(" (%1 duplicates merged)").arg(converter->duplicatesMerged()));
+    }
+    totalLabel->setText(total);
+
+    // reverse or save was requested before anything was imported
+    if (action == NoAction) return;
+    if (converter->records.isEmpty()) {
+        QMessageBox::information(this, tr("Versatacts"), tr("There are no records to save!"));
+    } else if (action == ReverseAction) {
+        reverseNames();
+    } else if (action == SaveAction) {
+        saveVCF();
+    }
 }
 
 void Versatacts::resetAll()
@@ -138,20 +414,43 @@ void Versatacts::resetAll()
     disconnect(contactsPathLineEdit, SIGNAL(textChanged(QString)), this, SLOT(importRecords()));
     contactsPathLineEdit->clear();
     connect(contactsPathLineEdit, SIGNAL(textChanged(QString)), this, SLOT(importRecords()));
-    vcfTextEdit->clear();
     totalLabel->setText(tr("Total Records: 0"));
-    records.clear();
-    totalRecords = -1;
+    converter->records.clear();
+    converter->searchIndex()->clear();
+    converter->totalRecords = -1;
+    searchLineEdit->clear();
+    updatePreview();
 }
 
 void Versatacts::selectContactsFile()
 {
-    QString path = QFileDialog::getOpenFileName(this,
-                                                tr("Select contacts file:"),
-                                                QDir::currentPath(),
-                                                tr("Contacts (*.pbb *.monosim)"));
-    if (path.isEmpty()) return;
-    contactsPathLineEdit->setText(path);
+    QStringList paths = QFileDialog::getOpenFileNames(this,
+                                                      tr("Select contacts files:"),
+                                                      QDir::currentPath(),
+                                                      tr("Contacts (*.pbb *.monosim *.vcsnap *.pbb.gz *.monosim.gz *.pbb.zst *.monosim.zst);;All files (*)"));
+    if (paths.isEmpty()) return;
+
+    // several files are shown quoted like the file dialog does
+    if (paths.count() == 1) {
+        contactsPathLineEdit->setText(paths.first());
+    } else {
+        contactsPathLineEdit->setText("\"" + paths.join("\" \"") + "\"");
+    }
+}
+
+// the paths of a quoted list of files or the text itself
+QStringList Versatacts::selectedPaths(const QString &text)
+{
+    if (!text.startsWith(QLatin1Char('"'))) return QStringList(text);
+
+    QStringList paths;
+    QRegExp quoted("\"([^\"]+)\"");
+    int pos = 0;
+    while ((pos = quoted.indexIn(text, pos)) >= 0) {
+        paths << quoted.cap(1);
+        pos += quoted.matchedLength();
+    }
+    return paths;
 }
 
 void Versatacts::selectVcfFolder()
@@ -164,16 +463,20 @@ void Versatacts::selectVcfFolder()
     contactsPathLineEdit->setText(path);
 }
 
-int Versatacts::importRecords()
+// starts the import in the background. returns false if nothing could
+// be started.
+bool Versatacts::importRecords()
 {
-    records.clear();
-    vcfTextEdit->clear();
+    if (jobWatcher->isRunning()) return false;
+
+    converter->records.clear();
+    updatePreview();
     totalLabel->setText(tr("Total Records: 0"));
 
     QString contactsPath = contactsPathLineEdit->text();
     if (contactsPath.isEmpty()) {
         QMessageBox::information(this, tr("Versatacts"), tr("Please select the input source."));
-        return records.count();
+        return false;
     }
 
     // convert local file url to local path
@@ -188,506 +491,286 @@ int Versatacts::importRecords()
         // the file doesn't exist due to the extra spaces in the
         // file name.
         contactsPath.remove(QRegExp("\\s+$"));
+        // changing the text triggers the import again with the new path
         contactsPathLineEdit->setText(contactsPath);
+        return jobWatcher->isRunning();
     }
 
-    // get file extension
-    QFile contactsFile(contactsPath);
-    QFileInfo fi(contactsFile);
-    QString ext = fi.suffix().toLower();
-
-    if (!contactsFile.exists()) {
-        QMessageBox::information(this, tr("Versatacts"), tr("The input source cannot be found. Please try again."));
-        return records.count();
-    }
-
-    if (fi.isDir()) {
-        mergeRecords(contactsPath);
-        generateVCF();
-        return records.count();
-    }
-
-    if (!contactsFile.open(QIODevice::ReadOnly)) {
-        QMessageBox::information(this, tr("Versatacts"), tr("The input source cannot be opened. Please try again."));
-        contactsFile.close();
-        contactsFile.deleteLater();
-        return records.count();
-    }
-
-    if (ext == "monosim") {
-        importMonosim(&contactsFile);
-    } else if (ext == "pbb") {
-        importPBB(&contactsFile);
-        sanitizeRecords();
-    }
-
-    contactsFile.close();
-    contactsFile.deleteLater();
-
-    generateVCF();
-    return records.count();
+    QSettings settings;
+    settings.setValue("import/deduplicate", dedupCheckBox->isChecked());
+    converter->setDeduplicate(dedupCheckBox->isChecked());
+
+    jobKind = ImportJob;
+    contactModel->setSuspended(true);
+    setBusy(true);
+    // a selection of files is decoded concurrently. a snapshot is indexed
+    // here rather than by the first search on the gui thread.
+    QStringList paths = selectedPaths(contactsPath);
+    jobWatcher->setFuture(QtConcurrent::run([this, contactsPath, paths]() {
+        bool ok = paths.count() > 1 ? converter->importFiles(paths) : converter->importFile(contactsPath);
+        if (ok) converter->indexRecords();
+        return ok;
+    }));
+    return true;
 }
 
-void Versatacts::mergeRecords(QString path)
+void Versatacts::updatePreview()
 {
-    QDir dir(path);
-    dir.setNameFilters(QStringList() << "*.vcf");
-    QStringList fileList = dir.entryList();
-
-    int totalSuccessful = 0;
+    contactModel->reload();
+    showCard(QModelIndex());
+}
 
-    QString line;
-    QStringList record,names;
+void Versatacts::togglePreview(bool checked)
+{
+    previewSplitter->setVisible(checked);
+}
 
-    records.clear();
-    vcfTextEdit->clear();
-    totalLabel->setText(tr("Total Records: 0"));
+void Versatacts::showCard(const QModelIndex &index)
+{
+    // cards can't be changed while a job is using the records
+    bool isEditable = index.isValid() && !jobWatcher->isRunning();
+    cardEdit->setPlainText(contactModel->data(index, Qt::EditRole).toString());
+    cardEdit->setEnabled(isEditable);
+    applyButton->setEnabled(isEditable);
+}
 
-    QProgressDialog progress("Importing contacts", "Abort", 0, fileList.count(), this);
-    progress.setWindowModality(Qt::WindowModal);
-    progress.setMinimumDuration(0);
-    progress.show();
-
-    for (int i=0; i<fileList.count(); i++) {
-        progress.setValue(i);
-        if (progress.wasCanceled()) break;
-
-        QFile contactsFile(path + QDir::separator() + fileList[i]);
-        if (!contactsFile.exists() || !contactsFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
-            QMessageBox::information(this, tr("Versatacts"), fileList[i] + tr(" cannot be opened. Please try again."));
-            contactsFile.close();
-            contactsFile.deleteLater();
-            continue;
-        }
+void Versatacts::applyCard()
+{
+    QModelIndex index = contactsView->currentIndex();
+    if (!index.isValid() || jobWatcher->isRunning()) return;
+
+    // the edited card keeps its row even if it no longer matches the
+    // search, the index only affects the next one
+    contactModel->setData(index, cardEdit->toPlainText(), Qt::EditRole);
+    converter->searchIndex()->updateRecord(converter->records, contactModel->record(index.row()));
+    showCard(index);
+}
 
-        QTextStream inStream(&contactsFile);
-
-        while (!inStream.atEnd()) {
-            if (progress.wasCanceled()) break;
-
-            line = inStream.readLine();
-
-            // remove whitespace at beginning and end of line
-            line = line.trimmed();
-
-            if (line.isEmpty() ||
-                line.startsWith("BEGIN:", Qt::CaseInsensitive) ||
-                line.startsWith("VERSION:", Qt::CaseInsensitive) ||
-                line.startsWith("n:", Qt::CaseInsensitive)) continue;
-
-            if (line.startsWith("END:", Qt::CaseInsensitive)) {
-                if (record.count() > 0) {
-                    records << record;
-                    record.clear();
-                    totalSuccessful++;
-                }
-                continue;
-            }
-
-            if (line.startsWith("FN:", Qt::CaseInsensitive)) {
-                line.remove(0,3);
-                names.clear();
-                names = line.split(" ", QString::SkipEmptyParts);
-                record << "F:" + names[0];
-                // we don't attempt to detect names other than first, last.
-                // so we pop the first since it was saved above and join
-                // the remaining as the last name. it won't always be
-                // accurate but the reverse names feature can fix it.
-                names.pop_front();
-                if (names.count() > 0) record << "L:" + names.join(" ");
-                continue;
-            }
-            record << line;
-        }
+void Versatacts::reverseNames()
+{
+    if (jobWatcher->isRunning()) return;
+
+    // there's no point in reversing names if we don't have any records.
+    // import them here without prompting user and reverse them once the
+    // import has finished.
+    if (converter->records.isEmpty()) {
+        pendingAction = ReverseAction;
+        if (!importRecords()) pendingAction = NoAction;
+        return;
+    }
 
-        if (record.count() > 0) {
-            records << record;
-            record.clear();
-            totalSuccessful++;
-        }
+    // only the swapped records are repainted. the open card is refreshed
+    // if it was one of them.
+    QVector<int> changed = converter->reverseNames();
+    contactModel->updateRecords(changed);
 
-        contactsFile.close();
-        contactsFile.deleteLater();
+    QModelIndex current = contactsView->currentIndex();
+    if (current.isValid() && std::binary_search(changed.constBegin(), changed.constEnd(), contactModel->record(current.row()))) {
+        showCard(current);
     }
-
-    progress.setValue(fileList.count());
-    totalLabel->setText(tr("Total Records: ") + QString::number(totalSuccessful));
 }
 
-void Versatacts::importMonosim(QFile *file)
+void Versatacts::saveVCF()
 {
-    QString line;
-    QString detectPhone = "^[\\#\\+]?\\d{2,11}$";
-    QStringList record,names;
+    if (jobWatcher->isRunning()) return;
 
-    // records is a public list so always clear it
-    records.clear();
-    vcfTextEdit->clear();
-    totalLabel->setText(tr("Total Records: 0"));
+    // the vcf is written straight from the records so only import them
+    // here if there are none. the save dialog follows the import.
+    if (converter->records.isEmpty()) {
+        pendingAction = SaveAction;
+        if (!importRecords()) pendingAction = NoAction;
+        return;
+    }
 
-    QTextStream inStream(file);
+    qint64 tstamp = QDateTime::currentMSecsSinceEpoch();
+    QString vcfName = QDir::currentPath() + QDir::separator() + "contacts_" + QString::number(tstamp) + ".vcf";
 
-    QProgressDialog progress("Importing contacts", "Abort", 0, file->size(), this);
-    progress.setWindowModality(Qt::WindowModal);
-    progress.setMinimumDuration(0);
-    progress.show();
+    QString savePath = QFileDialog::getSaveFileName(this,
+                        tr("Save vcf file:"), vcfName, tr("vCard (*.vcf);;Compressed vCard (*.vcf.gz *.vcf.zst)"));
+    if (savePath.isEmpty()) return;
 
-    while (!inStream.atEnd()) {
-        line = inStream.readLine();
+    // a name ending in .gz or .zst compresses the vcf while it is written
+    CompressedDevice::Format format = CompressedDevice::formatForPath(savePath);
+    if (!CompressedDevice::isSupported(format)) {
+        QMessageBox::information(this, tr("Versatacts"), tr("This version can't write zstd files. Please try again."));
+        return;
+    }
 
-        progress.setValue(progress.value() + line.count());
-        if (progress.wasCanceled()) break;
+    // export/shardCards and export/shardSize (in kilobytes) split the
+    // vcf into numbered files, export/manifest lists them in a json file
+    QSettings settings;
+    int shardCards = settings.value("export/shardCards", 0).toInt();
+    qint64 shardBytes = settings.value("export/shardSize", 0).toLongLong() * 1024;
+    if (shardCards > 0 || shardBytes > 0) {
+        bool writeManifest = settings.value("export/manifest", false).toBool();
+        jobKind = ShardJob;
+        setBusy(true);
+        jobWatcher->setFuture(QtConcurrent::run([this, savePath, shardCards, shardBytes, writeManifest]() {
+            return converter->generateShards(savePath, shardCards, shardBytes, writeManifest);
+        }));
+        return;
+    }
 
-        // remove whitespace at beginning and end of line
-        line = line.trimmed();
+    // the stage covers opening, writing and closing the file
+    saveStage = new StageReport::Stage("saveVCF", contactsPathLineEdit->text());
+    saveFile = new QFile(savePath);
+    if (saveFile->exists()) {
+        // qfiledialog automatically prompts before overwriting so we
+        // don't need to display the messagebox below
+        /*if (QMessageBox::information(this, tr("Versatacts"),
+            tr("Are you sure you want to overwrite this file?"),
+            QMessageBox::Ok | QMessageBox::Cancel) == QMessageBox::Cancel) return;*/
+        saveFile->remove();
+    }
 
-        if (line.isEmpty()) continue;
+    QIODevice::OpenMode mode = QIODevice::WriteOnly;
+    if (format == CompressedDevice::Plain) mode |= QIODevice::Text;
+    if (!saveFile->open(mode)) {
+        delete saveStage;
+        saveStage = 0;
+        delete saveFile;
+        saveFile = 0;
+        QMessageBox::information(this, tr("Versatacts"), tr("The output file cannot be opened for writing. Please try again."));
+        return;
+    }
 
-        if (line.contains(QRegExp(detectPhone))) {
-            record << "TEL;TYPE=CELL:" + line;
-            records << record;
-            record.clear();
-        } else {
-            names.clear();
-            names = line.split(" ", QString::SkipEmptyParts);
-            record << "F:" + names[0];
-            // we don't attempt to detect names other than first, last.
-            // so we pop the first since it was saved above and join
-            // the remaining as the last name. it won't always be
-            // accurate but the reverse names feature can fix it.
-            names.pop_front();
-            if (names.count() > 0) record << "L:" + names.join(" ");
+    // the file is closed by finishJob once the records are written
+    QIODevice *device = saveFile;
+    if (format != CompressedDevice::Plain) {
+        saveDeflater = new CompressedDevice(saveFile, format);
+        if (!saveDeflater->open(QIODevice::WriteOnly)) {
+            QString error = saveDeflater->errorString();
+            delete saveDeflater;
+            saveDeflater = 0;
+            saveFile->close();
+            saveFile->remove();
+            delete saveStage;
+            saveStage = 0;
+            delete saveFile;
+            saveFile = 0;
+            QMessageBox::information(this, tr("Versatacts"), error + tr(" Please try again."));
+            return;
         }
+        device = saveDeflater;
     }
-
-    progress.setValue(file->size());
-    totalLabel->setText(tr("Total Records: ").append(QString::number(records.count())));
+    jobKind = SaveJob;
+    setBusy(true);
+    jobWatcher->setFuture(QtConcurrent::run([this, device]() {
+        return converter->generateVCF(device);
+    }));
 }
 
-void Versatacts::importPBB(QFile *pbbFile)
-{    
-    bool ok;
-
-    int dataSize;
-    int bufSize = 1;
-    totalRecords = -1; // total number of contacts as displayed in input file
-    int recordIndex = 1; // index of current record - starts at 0 but we start at 1 since there's no easy way to detect record 0
-    int isLastBlank = 0; // 0=false, 1=true, 2=split into new line
-
-    char *buf = new char[bufSize];
-
-    QByteArray line;
-    QStringList name;
-    QStringList record;
-
-    // records is a public list so always clear it
-    records.clear();
-    vcfTextEdit->clear();
-    totalLabel->setText(tr("Total Records: 0"));
-
-    QProgressDialog progress("Importing contacts", "Abort", 0, pbbFile->size(), this);
-    progress.setWindowModality(Qt::WindowModal);
-    progress.setMinimumDuration(0);
-    progress.show();
-
-    while (!pbbFile->atEnd()) {
-        progress.setValue(progress.value() + bufSize);
-        if (progress.wasCanceled()) break;
-
-        dataSize = pbbFile->read(buf, bufSize);
-        QByteArray ba = QByteArray::fromRawData(buf, bufSize);
-
-        // current character is 00
-        if (ba.left(1).toHex().toInt(&ok, 16) == 0) {
-            // if the last character was also blank then increase isLastBlank.
-            // after 2 consecutive blank characters isLastBlank will equal 2
-            // while will trigger a new line when the next non-blank character
-            // is detected.
-            if (isLastBlank < 2) isLastBlank++;
-            // nothing to do with blank characters so skip ahead
-            continue;
-        }
-
-        // we need the last character of the first line which tells
-        // us how many records the pbb contains. the rest of line 1
-        // is junk. we display the total in a qlabel here.
-        if (isLastBlank == 2 && totalRecords < 0 && records.count() == 0 && record.count() == 0) {
-                totalRecords = line.right(1).toHex().toInt(&ok, 16);
-                //totalLabel->setText(tr("Total Records: ").append(QString::number(totalRecords)));
-                // we found the total so no need to retain the current line
-                line.clear();
-                line.append(ba); // save current character
-                isLastBlank = 0; // reset blank character detection
-                continue;
-        }
-
-        // detect database record separators here (010102, 020102, 030102, etc)
-        if (isLastBlank == 2 && line.count() < 4 && line.left(1).toHex().toInt(&ok, 16) == recordIndex && (recordIndex > 2 || line.count() > 1)) {
-            name.clear();
-            for (int i=0; i<2; i++) {
-                if (record.count() < 1) break; // make sure record has entries since we may be removing some
-
-                // make sure last line is not email, phone or url. we're trying to
-                // retrieve first and last name here from end of previous record.
-                if (record.last().contains("@") ||
-                    record.last().contains("://") ||
-                    record.last().contains(QRegExp("^[\\#\\+]?\\d{2,11}$"))) break;
-
-                name << record.last();
-                record.pop_back();
-            }
-
-            // if record contains values save it and clear it. time to move on to new record.
-            if (record.count() > 0) {
-                records << record;
-                record.clear();
-            }
-
-            // if we found a name above then save it to new record
-            if (name.count() > 0) record << name;
-
-            // the current line represents a database separator. no need to save the line.
-            line.clear();
-            if (records.count() > 0) recordIndex++; // ready for next record
-            line.append(ba); // save current character
-            isLastBlank = 0; // current character isn't blank so reset blank detection
-            continue;
-        }
-
-        if (isLastBlank == 2 && line.count() > 0) {
-            // save line to current record
-            record << line;
-            line.clear();
-            line.append(ba); // save current character
-            isLastBlank = 0; // reset blank detection
-            continue;
-        }
+void Versatacts::saveReport()
+{
+    if (jobWatcher->isRunning()) return;
 
-        // if we've made it this far then we know there is a valid character.
-        // append it to the current line and reset isLastBlank.
-        line.append(ba);
-        isLastBlank = 0;
+    if (converter->stageReport()->count() == 0) {
+        QMessageBox::information(this, tr("Versatacts"), tr("Nothing has been imported or saved yet."));
+        return;
     }
 
-    if (line.count() > 0) record << line; // grab final line of file since it isn't triggered in while loop
-    if (record.count() > 0) records << record;
+    qint64 tstamp = QDateTime::currentMSecsSinceEpoch();
+    QString reportName = QDir::currentPath() + QDir::separator() + "timings_" + QString::number(tstamp) + ".json";
 
-    progress.setValue(pbbFile->size());
+    QString reportPath = QFileDialog::getSaveFileName(this,
+                          tr("Save timing report:"), reportName, tr("JSON (*.json)"));
+    if (reportPath.isEmpty()) return;
 
-    // if there are more than 255 records the totalRecords value may be
-    // incorrect. always use records.count() for qlabel total and alert
-    // user via console if totals do not match. mismatch is unlikely
-    // since there is a limit on how many contacts you can store on a
-    // sim card.
-    totalLabel->setText(tr("Total Records: ").append(QString::number(records.count())));
-    if (totalRecords != records.count()) {
-        qDebug() << "Records total in pbb file does not match number of records detected!";
-        qDebug() << "Total:" << totalRecords << " Detected:" << records.count();
+    if (!converter->stageReport()->save(reportPath)) {
+        QMessageBox::information(this, tr("Versatacts"), tr("The report could not be written. Please try again."));
     }
-
-    // prevents compiler warning
-    Q_UNUSED(dataSize);
 }
 
-void Versatacts::sanitizeRecords()
+// an empty search shows all records. reversing names doesn't change the
+// words of a name so the index stays valid.
+void Versatacts::filterContacts(const QString &text)
 {
-    QString invalidChars = "[^\\w\\.\\+ \\#\\@\\-\\,\\:\\/]";
-    QString invalidNameChars = "[]";
-    QString invalidPhoneChars = "[]";
-    QString invalidEmailChars = "[]";
-    QString invalidUrlChars = "[]";
-    QString invalidAddressChars = "[]";
-
-    QString trimEdges = "^[^\\w\\+\\#]+|\\W+$";
-
-    QString detectName = "^[A-Za-z_\\- \\.]+$";
-    QString detectPhone = "^[\\#\\+]?\\d{2,11}$";
-    QString detectEmail = "@";
-    QString detectUrl = "://";
-    QString detectAddress = "^\\d+ \\w+";
-
-    QStringList telTypes;
-    telTypes << "CELL" << "HOME" << "WORK" << "OTHER";
-    QStringList emailTypes;
-    emailTypes << "HOME" << "WORK" << "OTHER";
-
-    int telTotal,emailTotal;
-
-    QProgressDialog progress("Sanitizing contacts", "Abort", 0, records.count(), this);
-    progress.setWindowModality(Qt::WindowModal);
-    progress.setMinimumDuration(0);
-    progress.show();
-
-    for (int i=0; i<records.count(); i++) {
-        progress.setValue(i);
-        if (progress.wasCanceled()) break;
-
-        telTotal = 0;
-        emailTotal = 0;
-        for (int j=0; j<records[i].count(); j++) {
-            if (progress.wasCanceled()) break;
-
-            records[i][j].remove(QRegExp(invalidChars));
-            records[i][j].remove(QRegExp(trimEdges));
-
-            if (records[i][j].isEmpty()) {
-                records[i].removeAt(j);
-                j--; // back up if record was removed to avoid skipping any
-                continue;
-            }
-
-            if (j == 0) { // first entry is always name
-                records[i][j].prepend("F:");
-            } else if (j == 1 && records[i][j].contains(QRegExp(detectName))) { // second entry might also be name
-                records[i][j].prepend("L:");
-            } else if (records[i][j].contains(QRegExp(detectPhone))) {
-                records[i][j].prepend(tr("TEL;TYPE=%1:").arg(telTypes[telTotal]));
-                if (telTotal < telTypes.count() - 1) telTotal++;
-            } else if (records[i][j].contains(QRegExp(detectEmail))) {
-                records[i][j].prepend(tr("EMAIL;TYPE=%1:").arg(emailTypes[emailTotal]));
-                if (emailTotal < emailTypes.count() - 1) emailTotal++;
-            } else if (records[i][j].contains(QRegExp(detectUrl))) {
-                records[i][j].prepend("URL:");
-            } else if (records[i][j].contains(QRegExp(detectAddress))) {
-                records[i][j].prepend("ADR:");
-            } else {
-                records[i][j].prepend("NOTE:");
-            }
-        }
+    if (jobWatcher->isRunning()) return;
+
+    QString query = text.trimmed();
+    if (query.isEmpty()) {
+        contactModel->clearFilter();
+    } else {
+        contactModel->setFilter(converter->findRecords(query));
     }
-    progress.setValue(records.count());
+    showCard(contactsView->currentIndex());
 }
 
-void Versatacts::generateVCF()
+// watch/debounce and watch/pollInterval are in milliseconds.
+// watch/rotate writes every batch to a new numbered file instead of
+// appending to the output.
+void Versatacts::toggleWatch(bool checked)
 {
-    QProgressDialog progress("Generating VCF", "Abort", 0, records.count(), this);
-    progress.setWindowModality(Qt::WindowModal);
-    progress.setMinimumDuration(0);
-    progress.show();
-
-    QString ntype;
-    QStringList names;
-    bool isNameOutput = false;
-    vcfTextEdit->clear();
-
-    for (int i=0; i<records.count(); i++) {
-        progress.setValue(i);
-        if (progress.wasCanceled()) break;
-
-        ntype = "";
-        names.clear();
-        isNameOutput = false;
-        vcfTextEdit->append("BEGIN:VCARD\nVERSION:3.0");
-        for (int j=0; j<records[i].count(); j++) {
-            if (progress.wasCanceled()) break;
-
-            ntype = records[i][j].left(2);
-            if (ntype == "F:" || ntype == "L:") {
-                names << records[i][j].mid(2);
-                if (records[i].count() > j + 1) continue;
-            }
-
-            // isNameOutput keeps track of whether we've displayed the name
-            // in the text box
-            if (!isNameOutput) {
-                if (names.count() < 2) names << "";
-                vcfTextEdit->append(tr("n:%1;%2;;;;").arg(names[1]).arg(names[0]));
-                vcfTextEdit->append(tr("FN:%1 %2").arg(names[0]).arg(names[1]));
-                isNameOutput = true;
-            }
-
-            if (ntype != "F:" && ntype != "L:") {
-                vcfTextEdit->append(records[i][j]);
-            }
-        }
-        vcfTextEdit->append("END:VCARD");
+    if (!checked) {
+        if (!folderWatcher->isWatching()) return;
+        folderWatcher->stop();
+        statusBar()->showMessage(tr("Stopped watching"), 5000);
+        return;
     }
 
-    progress.setValue(records.count());
-}
-
-void Versatacts::reverseNames()
-{
-    // there's no point in reversing names if we don't have any vcf text.
-    // just generate the vcf here without prompting user if there are
-    // records or import records if there are none.
-    if (vcfTextEdit->toPlainText().isEmpty()) {
-        if (records.count() > 0) {
-            generateVCF();
-        } else if (importRecords() < 1) {
-            QMessageBox::information(this, tr("Versatacts"), tr("There are no records to save!"));
-            return;
-        }
+    QString folder = QFileDialog::getExistingDirectory(this,
+                                                       tr("Select the folder to watch"),
+                                                       QDir::currentPath(),
+                                                       QFileDialog::ShowDirsOnly | QFileDialog::DontResolveSymlinks);
+    QString outputPath;
+    if (!folder.isEmpty()) {
+        outputPath = QFileDialog::getSaveFileName(this,
+                      tr("Add new contacts to:"), QDir::currentPath() + QDir::separator() + "watched.vcf",
+                      tr("vCard (*.vcf);;Compressed vCard (*.vcf.gz *.vcf.zst)"), 0, QFileDialog::DontConfirmOverwrite);
+    }
+    if (outputPath.isEmpty()) {
+        watchFolderAction->setChecked(false);
+        return;
     }
 
-    int fnIndex,lnIndex;
-    QString ntype,fname,lname;
-    for (int i=0; i<records.count(); i++) {
-        fnIndex = -1;
-        lnIndex = -1;
-        ntype = "";
-        fname = "";
-        lname = "";
-        for (int j=0; j<records[i].count(); j++) {
-            ntype = records[i][j].left(2);
-            if (ntype == "F:") {
-                fnIndex = j;
-            } else if (ntype == "L:") {
-                lnIndex = j;
-            }
-        }
-        if (fnIndex > -1 && lnIndex > -1){
-            fname = records[i][fnIndex].mid(2);
-            lname = records[i][lnIndex].mid(2);
-            records[i][fnIndex] = "F:" + lname;
-            records[i][lnIndex] = "L:" + fname;
-        }
+    QSettings settings;
+    folderWatcher->setDebounceInterval(settings.value("watch/debounce", 2000).toInt());
+    folderWatcher->setPollInterval(settings.value("watch/pollInterval", 10000).toInt());
+    folderWatcher->converter()->setMaxThreads(converter->maxThreads());
+    folderWatcher->converter()->setBinaryLimit(converter->binaryLimit());
+    FolderWatcher::OutputMode mode = settings.value("watch/rotate", false).toBool() ? FolderWatcher::RotateOutput
+                                                                                  : FolderWatcher::AppendOutput;
+
+    if (!folderWatcher->start(folder, outputPath, mode)) {
+        QMessageBox::information(this, tr("Versatacts"), folderWatcher->errorString() + tr(" Please try again."));
+        watchFolderAction->setChecked(false);
+        return;
     }
-    generateVCF();
+    statusBar()->showMessage(tr("Watching %1").arg(QDir::toNativeSeparators(folder)));
 }
 
-void Versatacts::saveVCF()
+void Versatacts::showIngested(const QStringList &files, int records)
 {
-    // there's no point in reversing names if we don't have any vcf text.
-    // just generate the vcf here without prompting user if there are
-    // records or import records if there are none.
-    if (vcfTextEdit->toPlainText().isEmpty()) {
-        if (records.count() > 0) {
-            generateVCF();
-        } else if (importRecords() < 1) {
-            QMessageBox::information(this, tr("Versatacts"), tr("There are no records to save!"));
-            return;
-        }
-    }
-
-    qint64 tstamp = QDateTime::currentMSecsSinceEpoch();
-    QString vcfName = QDir::currentPath() + QDir::separator() + "contacts_" + QString::number(tstamp) + ".vcf";
+    statusBar()->showMessage(tr("%1 new records from %2 files").arg(records).arg(files.count()), 10000);
+}
 
-    QString savePath = QFileDialog::getSaveFileName(this,
-                        tr("Save vcf file:"), vcfName, tr("vCard (*.vcf)"));
-    if (savePath.isEmpty()) return;
+// problems of the watched folder must not interrupt with a dialog
+void Versatacts::showStatus(const QString &message)
+{
+    statusBar()->showMessage(message, 10000);
+}
 
-    QFile vcfFile(savePath);
-    if (vcfFile.exists()) {
-        // qfiledialog automatically prompts before overwriting so we
-        // don't need to display the messagebox below
-        /*if (QMessageBox::information(this, tr("Versatacts"),
-            tr("Are you sure you want to overwrite this file?"),
-            QMessageBox::Ok | QMessageBox::Cancel) == QMessageBox::Cancel) return;*/
-        vcfFile.remove();
-    }
+// a snapshot of the records can be opened again without parsing the
+// original sources
+void Versatacts::saveSnapshot()
+{
+    if (jobWatcher->isRunning()) return;
 
-    if (!vcfFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        vcfFile.close();
-        vcfFile.deleteLater();
-        QMessageBox::information(this, tr("Versatacts"), tr("The output file cannot be opened for writing. Please try again."));
+    if (converter->records.isEmpty()) {
+        QMessageBox::information(this, tr("Versatacts"), tr("There are no records to save!"));
         return;
     }
 
-    vcfFile.write(vcfTextEdit->toPlainText().toLocal8Bit().data());
+    qint64 tstamp = QDateTime::currentMSecsSinceEpoch();
+    QString snapshotName = QDir::currentPath() + QDir::separator() + "contacts_" + QString::number(tstamp) + ".vcsnap";
 
-    vcfFile.close();
-    vcfFile.deleteLater();
+    QString snapshotPath = QFileDialog::getSaveFileName(this,
+                            tr("Save snapshot:"), snapshotName, tr("Snapshot (*.vcsnap)"));
+    if (snapshotPath.isEmpty()) return;
 
-    QMessageBox::information(this, tr("Versatacts"), tr("Success!"));
+    jobKind = SnapshotJob;
+    setBusy(true);
+    jobWatcher->setFuture(QtConcurrent::run([this, snapshotPath]() {
+        return converter->saveSnapshot(snapshotPath);
+    }));
 }
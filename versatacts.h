@@ -27,24 +27,42 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef VERSATACTS_H
 #define VERSATACTS_H
 
+#include "contactconverter.h"
+#include "contactmodel.h"
+#include "folderwatcher.h"
+
+#include <QAction>
+#include <QCheckBox>
+#include <QCloseEvent>
 #include <QDateTime>
 #include <QDebug>
 #include <QDir>
 #include <QFile>
 #include <QFileDialog>
+#include <QFutureWatcher>
 #include <QHBoxLayout>
 #include <QIODevice>
 #include <QLabel>
 #include <QLineEdit>
+#include <QListView>
 #include <QMainWindow>
+#include <QMenu>
+#include <QMenuBar>
 #include <QMessageBox>
-#include <QProgressDialog>
+#include <QPlainTextEdit>
+#include <QProgressBar>
+#include <QPushButton>
 #include <QRegExp>
-#include <QTextEdit>
+#include <QSettings>
+#include <QSplitter>
+#include <QStatusBar>
 #include <QTextStream>
 #include <QToolButton>
 #include <QUrl>
 #include <QVBoxLayout>
+#include <QtConcurrentRun>
+
+#include <algorithm>
 
 class Versatacts : public QMainWindow
 {
@@ -53,27 +71,75 @@ class Versatacts : public QMainWindow
 public:
     Versatacts(QWidget *parent = 0);
     ~Versatacts();
-    QList<QStringList> records;
-    int totalRecords;
+
+protected:
+    void closeEvent(QCloseEvent *event);
 
 private slots:
     void selectContactsFile();
     void selectVcfFolder();
     void resetAll();
-    int importRecords();
+    bool importRecords();
     void saveVCF();
     void reverseNames();
+    void startProgress(const QString &label, int maximum);
+    void updateProgress(int value);
+    void finishProgress();
+    void showWarning(const QString &message);
+    void togglePreview(bool checked);
+    void showCard(const QModelIndex &index);
+    void applyCard();
+    void finishJob();
+    void saveSnapshot();
+    void saveReport();
+    void filterContacts(const QString &text);
+    void toggleWatch(bool checked);
+    void showIngested(const QStringList &files, int records);
+    void showStatus(const QString &message);
 
 private:
+    enum JobKind {
+        NoJob,
+        ImportJob,
+        SaveJob,
+        ShardJob,
+        SnapshotJob
+    };
+
+    enum PendingAction {
+        NoAction,
+        ReverseAction,
+        SaveAction
+    };
+
     void connectEvents();
-    void sanitizeRecords();
-    void mergeRecords(QString path);
-    void generateVCF();
-    void importPBB(QFile *pbbFile);
-    void importMonosim(QFile *file);
+    void updatePreview();
+    void setBusy(bool busy);
+    static QStringList selectedPaths(const QString &text);
+    ContactConverter *converter;
+    ContactModel *contactModel;
+    FolderWatcher *folderWatcher;
+    QFutureWatcher<bool> *jobWatcher;
+    JobKind jobKind;
+    PendingAction pendingAction;
+    QFile *saveFile;
+    CompressedDevice *saveDeflater;
+    StageReport::Stage *saveStage;
+    QAction *saveSnapshotAction;
+    QAction *saveReportAction;
+    QAction *watchFolderAction;
+    QLabel *progressLabel;
+    QProgressBar *progressBar;
+    QPushButton *cancelButton;
     QLabel *totalLabel;
+    QCheckBox *previewCheckBox;
+    QCheckBox *dedupCheckBox;
     QLineEdit *contactsPathLineEdit;
-    QTextEdit *vcfTextEdit;
+    QLineEdit *searchLineEdit;
+    QListView *contactsView;
+    QPlainTextEdit *cardEdit;
+    QPushButton *applyButton;
+    QSplitter *previewSplitter;
     QToolButton *selectFileButton;
     QToolButton *selectFolderButton;
     QToolButton *resetButton;
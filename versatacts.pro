@@ -11,10 +11,14 @@ greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 TARGET = versatacts
 TEMPLATE = app
 
+include(versatacts-core.pri)
+
 
 SOURCES += main.cpp\
-        versatacts.cpp
+        versatacts.cpp\
+        contactmodel.cpp
 
-HEADERS  += versatacts.h
+HEADERS  += versatacts.h\
+        contactmodel.h
 
 RESOURCES += versatacts.qrc